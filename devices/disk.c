@@ -3,13 +3,26 @@
 #include <debug.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "devices/iosched.h"
+#include "devices/ramdisk.h"
 #include "devices/timer.h"
+#include "devices/virtio-blk.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
 
 /* The code in this file is an interface to an ATA (IDE)
-   controller.  It attempts to comply to [ATA-3]. */
+   controller.  It attempts to comply to [ATA-3].
+
+   Other drivers (see virtio-blk.c) can register further disks with
+   disk_register().  Those appear as extra channels, hd2:0, hd2:1,
+   hd3:0 and so on, and are read and written through the same
+   interface. */
 
 /* ATA command block port addresses. */
 #define reg_data(CHANNEL) ((CHANNEL)->reg_base + 0)     /* Data. */
@@ -48,17 +61,22 @@
 #define CMD_READ_SECTOR_RETRY 0x20      /* READ SECTOR with retries. */
 #define CMD_WRITE_SECTOR_RETRY 0x30     /* WRITE SECTOR with retries. */
 
-/* An ATA device. */
+/* A disk. */
 struct disk {
 	char name[8];               /* Name, e.g. "hd0:1". */
-	struct channel *channel;    /* Channel disk is on. */
+	struct channel *channel;    /* ATA channel disk is on, if any. */
 	int dev_no;                 /* Device 0 or 1 for master or slave. */
 
 	bool is_ata;                /* 1=This device is an ATA disk. */
-	disk_sector_t capacity;     /* Capacity in sectors (if is_ata). */
+	disk_sector_t capacity;     /* Capacity in sectors. */
+
+	const struct disk_driver *driver;   /* Driver that performs I/O. */
+	void *aux;                  /* Driver's private data. */
 
 	long long read_cnt;         /* Number of sectors read. */
 	long long write_cnt;        /* Number of sectors written. */
+
+	struct iosched_queue queue; /* Pending requests. */
 };
 
 /* An ATA channel (aka controller).
@@ -73,6 +91,10 @@ struct channel {
 								   any interrupt would be spurious. */
 	struct semaphore completion_wait;   /* Up'd by interrupt handler. */
 
+	struct lock queue_lock;     /* Protects the devices' request queues. */
+	struct condition queue_nonempty;    /* Signaled when a request arrives. */
+	int next_dev;               /* Device whose queue is served next. */
+
 	struct disk devices[2];     /* The devices on this channel. */
 };
 
@@ -80,11 +102,44 @@ struct channel {
 #define CHANNEL_CNT 2
 static struct channel channels[CHANNEL_CNT];
 
+/* Disks registered by other drivers, two per pseudo-channel
+   starting right after the ATA channels. */
+#define EXTRA_DISK_CNT 8
+static struct disk *extra_disks[EXTRA_DISK_CNT];
+static size_t extra_disk_cnt;
+
+/* Disk used for each role, as channel and device number. */
+static struct {
+	int chan_no, dev_no;
+} roles[DISK_ROLE_CNT] = {
+	[DISK_FILESYS] = { 0, 1 },
+	[DISK_SWAP] = { 1, 1 },
+};
+
+/* Scheduler given to each disk's request queue. */
+static const struct iosched *default_iosched = &iosched_deadline;
+
 static void reset_channel (struct channel *);
 static bool check_device_type (struct disk *);
 static void identify_ata_device (struct disk *);
 
-static void select_sector (struct disk *, disk_sector_t);
+static void request_init (struct disk_request *, disk_sector_t sec_no,
+		size_t sec_cnt, void *buffer, bool write,
+		disk_done_func *, void *aux);
+static void finish_request (struct disk_request *);
+static void print_capacity (const struct disk *);
+
+static void ata_submit (struct disk *, struct disk_request *);
+static void dispatch_requests (void *channel_);
+static void transfer_request (struct disk *, struct disk_request *);
+
+/* Driver for the disks on the ATA channels. */
+static const struct disk_driver ata_driver = {
+	.type = "ata",
+	.submit = ata_submit,
+};
+
+static void select_sector (struct disk *, disk_sector_t, size_t sec_cnt);
 static void issue_pio_command (struct channel *, uint8_t command);
 static void input_sector (struct channel *, void *);
 static void output_sector (struct channel *, const void *);
@@ -122,6 +177,9 @@ disk_init (void) {
 		lock_init (&c->lock);
 		c->expecting_interrupt = false;
 		sema_init (&c->completion_wait, 0);
+		lock_init (&c->queue_lock);
+		cond_init (&c->queue_nonempty);
+		c->next_dev = 0;
 
 		/* Initialize devices. */
 		for (dev_no = 0; dev_no < 2; dev_no++) {
@@ -132,8 +190,11 @@ disk_init (void) {
 
 			d->is_ata = false;
 			d->capacity = 0;
+			d->driver = &ata_driver;
+			d->aux = NULL;
 
 			d->read_cnt = d->write_cnt = 0;
+			iosched_queue_init (&d->queue, default_iosched);
 		}
 
 		/* Register interrupt handler. */
@@ -150,12 +211,33 @@ disk_init (void) {
 		for (dev_no = 0; dev_no < 2; dev_no++)
 			if (c->devices[dev_no].is_ata)
 				identify_ata_device (&c->devices[dev_no]);
+
+		/* Start the thread that issues queued requests. */
+		if (c->devices[0].is_ata || c->devices[1].is_ata)
+			thread_create (c->name, PRI_MAX, dispatch_requests, c);
 	}
 
+	/* Add the RAM disk, which is always hd2:0 if present, then
+	   detect disks on other controllers. */
+	ramdisk_init ();
+	virtio_blk_init ();
+
 	/* DO NOT MODIFY BELOW LINES. */
 	register_disk_inspect_intr ();
 }
 
+/* Selects the I/O scheduler named NAME for disks initialized from
+   now on.  Returns false if there is no such scheduler. */
+bool
+disk_set_iosched (const char *name) {
+	const struct iosched *sched = iosched_find (name);
+
+	if (sched == NULL)
+		return false;
+	default_iosched = sched;
+	return true;
+}
+
 /* Prints disk statistics. */
 void
 disk_print_stats (void) {
@@ -171,6 +253,11 @@ disk_print_stats (void) {
 						d->name, d->read_cnt, d->write_cnt);
 		}
 	}
+	for (size_t i = 0; i < extra_disk_cnt; i++) {
+		struct disk *d = extra_disks[i];
+		printf ("%s: %lld reads, %lld writes\n",
+				d->name, d->read_cnt, d->write_cnt);
+	}
 }
 
 /* Returns the disk numbered DEV_NO--either 0 or 1 for master or
@@ -181,7 +268,8 @@ disk_print_stats (void) {
 0:1 - file system
 1:0 - scratch
 1:1 - swap
-*/
+The file system and swap disks can be changed with disk_set_role().
+Channels 2 and up hold the disks registered with disk_register(). */
 struct disk *
 disk_get (int chan_no, int dev_no) {
 	ASSERT (dev_no == 0 || dev_no == 1);
@@ -190,10 +278,125 @@ disk_get (int chan_no, int dev_no) {
 		struct disk *d = &channels[chan_no].devices[dev_no];
 		if (d->is_ata)
 			return d;
+	} else {
+		size_t idx = (chan_no - CHANNEL_CNT) * 2 + dev_no;
+		if (idx < extra_disk_cnt)
+			return extra_disks[idx];
 	}
 	return NULL;
 }
 
+/* Parses NAME, written as "hdC:D" or "C:D", into *CHAN_NO and
+   *DEV_NO.  Returns false if NAME is malformed. */
+static bool
+parse_name (const char *name, int *chan_no, int *dev_no) {
+	const char *colon;
+
+	if (name == NULL)
+		return false;
+	if (name[0] == 'h' && name[1] == 'd')
+		name += 2;
+	colon = strchr (name, ':');
+	if (!isdigit (name[0]) || colon == NULL || !isdigit (colon[1]))
+		return false;
+	*chan_no = atoi (name);
+	*dev_no = atoi (colon + 1);
+	return *dev_no == 0 || *dev_no == 1;
+}
+
+/* Returns the disk NAME, written as "hdC:D" or "C:D", or a null
+   pointer if NAME is malformed or there is no such disk. */
+struct disk *
+disk_get_by_name (const char *name) {
+	int chan_no, dev_no;
+
+	if (!parse_name (name, &chan_no, &dev_no))
+		return NULL;
+	return disk_get (chan_no, dev_no);
+}
+
+/* Uses the disk NAME, written as "hdC:D" or "C:D", for ROLE.
+   Returns false if NAME is malformed.  Whether the disk exists is
+   only checked when the role's user calls disk_get_role(). */
+bool
+disk_set_role (enum disk_role role, const char *name) {
+	int chan_no, dev_no;
+
+	ASSERT (role < DISK_ROLE_CNT);
+
+	if (!parse_name (name, &chan_no, &dev_no))
+		return false;
+	roles[role].chan_no = chan_no;
+	roles[role].dev_no = dev_no;
+	return true;
+}
+
+/* Returns the disk used for ROLE, or a null pointer if it does not
+   exist. */
+struct disk *
+disk_get_role (enum disk_role role) {
+	ASSERT (role < DISK_ROLE_CNT);
+
+	return disk_get (roles[role].chan_no, roles[role].dev_no);
+}
+
+/* Returns true if D is the boot disk, the scratch disk or the disk
+   for some role, none of which may be used for anything else. */
+bool
+disk_is_reserved (struct disk *d) {
+	enum disk_role role;
+
+	if (d == disk_get (0, 0) || d == disk_get (1, 0))
+		return true;
+	for (role = 0; role < DISK_ROLE_CNT; role++)
+		if (d == disk_get_role (role))
+			return true;
+	return false;
+}
+
+/* Adds a disk of CAPACITY sectors driven by DRIVER, which may keep
+   its own state in AUX, and returns it.  The disk gets the next free
+   name after the ATA disks. */
+struct disk *
+disk_register (const struct disk_driver *driver, disk_sector_t capacity,
+		void *aux) {
+	struct disk *d;
+	size_t idx = extra_disk_cnt;
+
+	ASSERT (driver != NULL);
+
+	if (idx >= EXTRA_DISK_CNT)
+		PANIC ("too many disks");
+	d = calloc (1, sizeof *d);
+	if (d == NULL)
+		PANIC ("out of memory registering disk");
+
+	snprintf (d->name, sizeof d->name, "hd%zu:%zu",
+			CHANNEL_CNT + idx / 2, idx % 2);
+	d->channel = NULL;
+	d->dev_no = idx % 2;
+	d->is_ata = false;
+	d->capacity = capacity;
+	d->driver = driver;
+	d->aux = aux;
+	d->read_cnt = d->write_cnt = 0;
+	iosched_queue_init (&d->queue, default_iosched);
+
+	extra_disks[extra_disk_cnt++] = d;
+
+	print_capacity (d);
+	printf (" %s disk\n", driver->type);
+	return d;
+}
+
+/* Returns the AUX that D's driver passed to disk_register(). */
+void *
+disk_driver_data (struct disk *d) {
+	ASSERT (d != NULL);
+
+	return d->aux;
+}
+
 /* Returns the size of disk D, measured in DISK_SECTOR_SIZE-byte
    sectors. */
 disk_sector_t
@@ -209,22 +412,10 @@ disk_size (struct disk *d) {
    per-disk locking is unneeded. */
 void
 disk_read (struct disk *d, disk_sector_t sec_no, void *buffer) {
-	struct channel *c;
-
-	ASSERT (d != NULL);
-	ASSERT (buffer != NULL);
+	struct disk_request req;
 
-	//printf("capacity: %d", d->capacity);
-	c = d->channel;
-	lock_acquire (&c->lock);
-	select_sector (d, sec_no);
-	issue_pio_command (c, CMD_READ_SECTOR_RETRY);
-	sema_down (&c->completion_wait);
-	if (!wait_while_busy (d))
-		PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
-	input_sector (c, buffer);
-	d->read_cnt++;
-	lock_release (&c->lock);
+	disk_read_async (d, sec_no, 1, buffer, &req, NULL, NULL);
+	disk_wait (&req);
 }
 
 /* Write sector SEC_NO to disk D from BUFFER, which must contain
@@ -234,23 +425,214 @@ disk_read (struct disk *d, disk_sector_t sec_no, void *buffer) {
    per-disk locking is unneeded. */
 void
 disk_write (struct disk *d, disk_sector_t sec_no, const void *buffer) {
-	struct channel *c;
+	struct disk_request req;
+
+	disk_write_async (d, sec_no, 1, buffer, &req, NULL, NULL);
+	disk_wait (&req);
+}
+
+/* Starts reading CNT sectors, beginning at SEC_NO, from disk D into
+   BUFFER and returns without waiting, using REQ to track the
+   transfer.  REQ and BUFFER must stay valid until it completes.
+
+   If DONE_FUNC is non-null, it is called with REQ and AUX on
+   completion, possibly from an interrupt handler.  Otherwise the
+   caller must pass REQ to disk_wait().
+
+   BUFFER must be kernel memory: the transfer may run in a driver
+   thread, which has no user address space and cannot take page
+   faults. */
+void
+disk_read_async (struct disk *d, disk_sector_t sec_no, size_t cnt,
+		void *buffer, struct disk_request *req,
+		disk_done_func *done_func, void *aux) {
+	ASSERT (d != NULL);
+	ASSERT (buffer != NULL);
+	ASSERT (is_kernel_vaddr (buffer));
+
+	request_init (req, sec_no, cnt, buffer, false, done_func, aux);
+	ASSERT (sec_no + cnt <= d->capacity);
+	d->driver->submit (d, req);
+}
 
+/* Starts writing CNT sectors, beginning at SEC_NO, from BUFFER to
+   disk D, as disk_read_async(). */
+void
+disk_write_async (struct disk *d, disk_sector_t sec_no, size_t cnt,
+		const void *buffer, struct disk_request *req,
+		disk_done_func *done_func, void *aux) {
 	ASSERT (d != NULL);
 	ASSERT (buffer != NULL);
+	ASSERT (is_kernel_vaddr (buffer));
 
-	c = d->channel;
-	lock_acquire (&c->lock);
-	select_sector (d, sec_no);
-	issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
-	if (!wait_while_busy (d))
-		PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
-	output_sector (c, buffer);
-	sema_down (&c->completion_wait);
-	d->write_cnt++;
-	lock_release (&c->lock);
+	request_init (req, sec_no, cnt, (void *) buffer, true, done_func, aux);
+	ASSERT (sec_no + cnt <= d->capacity);
+	d->driver->submit (d, req);
 }
-
+
+/* Waits for REQ, started without a completion callback, to
+   complete. */
+void
+disk_wait (struct disk_request *req) {
+	ASSERT (req->done_func == NULL);
+
+	sema_down (&req->done);
+}
+
+/* Called by D's driver when REQ, and every request merged into it,
+   has been transferred.  Wakes up or calls back the requesters, each
+   of whom may reuse their request as soon as that happens.  May be
+   called from an interrupt handler. */
+void
+disk_complete (struct disk *d, struct disk_request *req) {
+	struct list_elem *e = list_begin (&req->merged);
+
+	if (req->write)
+		d->write_cnt += req->total_cnt;
+	else
+		d->read_cnt += req->total_cnt;
+
+	while (e != list_end (&req->merged)) {
+		struct disk_request *r = list_entry (e, struct disk_request, merge_elem);
+		e = list_next (e);
+		finish_request (r);
+	}
+	finish_request (req);
+}
+
+/* Initializes REQ as a request to transfer SEC_CNT sectors starting
+   at SEC_NO to (if WRITE) or from BUFFER, completed through
+   DONE_FUNC and AUX. */
+static void
+request_init (struct disk_request *req, disk_sector_t sec_no,
+		size_t sec_cnt, void *buffer, bool write,
+		disk_done_func *done_func, void *aux) {
+	ASSERT (sec_cnt > 0 && sec_cnt <= DISK_MAX_SECTORS);
+
+	req->sec_no = sec_no;
+	req->sec_cnt = sec_cnt;
+	req->write = write;
+	req->buffer = buffer;
+	req->deadline = 0;
+	req->total_cnt = sec_cnt;
+	list_init (&req->merged);
+	req->done_func = done_func;
+	req->done_aux = aux;
+	sema_init (&req->done, 0);
+}
+
+/* Hands REQ back to its requester. */
+static void
+finish_request (struct disk_request *req) {
+	if (req->done_func != NULL)
+		req->done_func (req, req->done_aux);
+	else
+		sema_up (&req->done);
+}
+
+/* Request queueing and dispatch.
+
+   Callers never touch the controller themselves.  They queue a
+   request on the disk and sleep on it; each channel has a dispatcher
+   thread that asks the disks' schedulers which request to issue next,
+   performs the transfer and wakes up the requesters.  While a
+   transfer is in progress, new requests pile up in the queue, where
+   they can be sorted and merged with their neighbors. */
+
+/* Queues REQ on ATA disk D and wakes up D's dispatcher. */
+static void
+ata_submit (struct disk *d, struct disk_request *req) {
+	struct channel *c = d->channel;
+
+	ASSERT (d->is_ata);
+
+	lock_acquire (&c->queue_lock);
+	d->queue.sched->add (&d->queue, req);
+	cond_signal (&c->queue_nonempty, &c->queue_lock);
+	lock_release (&c->queue_lock);
+}
+
+/* Returns a disk on channel C with pending requests, alternating
+   between the two devices so that neither can starve the other, or a
+   null pointer if both queues are empty. */
+static struct disk *
+next_disk (struct channel *c) {
+	int i;
+
+	ASSERT (lock_held_by_current_thread (&c->queue_lock));
+
+	for (i = 0; i < 2; i++) {
+		struct disk *d = &c->devices[(c->next_dev + i) % 2];
+		if (d->is_ata && !iosched_empty (&d->queue)) {
+			c->next_dev = (d->dev_no + 1) % 2;
+			return d;
+		}
+	}
+	return NULL;
+}
+
+/* Dispatcher thread for the channel passed as CHANNEL_. */
+static void
+dispatch_requests (void *channel_) {
+	struct channel *c = channel_;
+
+	for (;;) {
+		struct disk_request *req;
+		struct disk *d;
+
+		lock_acquire (&c->queue_lock);
+		while ((d = next_disk (c)) == NULL)
+			cond_wait (&c->queue_nonempty, &c->queue_lock);
+		req = d->queue.sched->next (&d->queue);
+		lock_release (&c->queue_lock);
+
+		lock_acquire (&c->lock);
+		transfer_request (d, req);
+		lock_release (&c->lock);
+
+		disk_complete (d, req);
+	}
+}
+
+/* Transfers REQ, including every request merged into it, with a
+   single multi-sector PIO command. */
+static void
+transfer_request (struct disk *d, struct disk_request *req) {
+	struct channel *c = d->channel;
+	struct list_elem *e = list_head (&req->merged);
+	struct disk_request *r = req;
+	disk_sector_t sec_no = req->sec_no;
+
+	select_sector (d, req->sec_no, req->total_cnt);
+	issue_pio_command (c, req->write
+			? CMD_WRITE_SECTOR_RETRY : CMD_READ_SECTOR_RETRY);
+	while (r != NULL) {
+		size_t i;
+
+		for (i = 0; i < r->sec_cnt; i++, sec_no++) {
+			uint8_t *buffer = (uint8_t *) r->buffer + i * DISK_SECTOR_SIZE;
+
+			if (!req->write) {
+				/* Each sector is announced by an interrupt. */
+				sema_down (&c->completion_wait);
+				if (!wait_while_busy (d))
+					PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
+				input_sector (c, buffer);
+			} else {
+				/* The disk interrupts once it has taken each sector. */
+				if (!wait_while_busy (d))
+					PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
+				output_sector (c, buffer);
+				sema_down (&c->completion_wait);
+			}
+		}
+
+		e = list_next (e);
+		r = e != list_end (&req->merged)
+			? list_entry (e, struct disk_request, merge_elem) : NULL;
+	}
+}
+
 /* Disk detection and identification. */
 
 static void print_ata_string (char *string, size_t size);
@@ -366,6 +748,18 @@ identify_ata_device (struct disk *d) {
 	d->capacity = id[60] | ((uint32_t) id[61] << 16);
 
 	/* Print identification message. */
+	print_capacity (d);
+	printf (" disk, model \"");
+	print_ata_string ((char *) &id[27], 40);
+	printf ("\", serial \"");
+	print_ata_string ((char *) &id[10], 20);
+	printf ("\"\n");
+}
+
+/* Prints the start of D's identification message: its name and
+   capacity. */
+static void
+print_capacity (const struct disk *d) {
 	printf ("%s: detected %'"PRDSNu" sector (", d->name, d->capacity);
 	if (d->capacity > 1024 / DISK_SECTOR_SIZE * 1024 * 1024)
 		printf ("%"PRDSNu" GB",
@@ -376,11 +770,7 @@ identify_ata_device (struct disk *d) {
 		printf ("%"PRDSNu" kB", d->capacity / (1024 / DISK_SECTOR_SIZE));
 	else
 		printf ("%"PRDSNu" byte", d->capacity * DISK_SECTOR_SIZE);
-	printf (") disk, model \"");
-	print_ata_string ((char *) &id[27], 40);
-	printf ("\", serial \"");
-	print_ata_string ((char *) &id[10], 20);
-	printf ("\"\n");
+	printf (")");
 }
 
 /* Prints STRING, which consists of SIZE bytes in a funky format:
@@ -403,17 +793,18 @@ print_ata_string (char *string, size_t size) {
 }
 
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
+   writes SEC_NO and SEC_CNT to the disk's sector selection
+   registers.  (We use LBA mode.) */
 static void
-select_sector (struct disk *d, disk_sector_t sec_no) {
+select_sector (struct disk *d, disk_sector_t sec_no, size_t sec_cnt) {
 	struct channel *c = d->channel;
 
-	ASSERT (sec_no < d->capacity);
-	ASSERT (sec_no < (1UL << 28));
+	ASSERT (sec_cnt > 0 && sec_cnt <= 256);
+	ASSERT (sec_no + sec_cnt <= d->capacity);
+	ASSERT (sec_no + sec_cnt <= (1UL << 28));
 
 	select_device_wait (d);
-	outb (reg_nsect (c), 1);
+	outb (reg_nsect (c), sec_cnt);   /* 256 is written as 0. */
 	outb (reg_lbal (c), sec_no);
 	outb (reg_lbam (c), sec_no >> 8);
 	outb (reg_lbah (c), (sec_no >> 16));
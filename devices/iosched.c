@@ -0,0 +1,254 @@
+#include "devices/iosched.h"
+#include <debug.h>
+#include <string.h>
+#include "devices/timer.h"
+
+/* I/O schedulers for the disk request queues.
+
+   Every disk keeps a queue of pending requests, and the channel's
+   dispatcher asks the disk's scheduler which one to issue next.
+   Three policies are provided:
+
+   - noop: first come, first served.  Only merges adjacent
+     requests.
+
+   - clook: circular LOOK elevator.  Requests are kept in sector
+     order and served in one sweep toward higher sectors, then the
+     head jumps back to the lowest pending sector.
+
+   - deadline: C-LOOK, but reads and writes are queued separately and
+     each request gets an expiry time.  Reads expire much sooner than
+     writes and are preferred, so a stream of writes (e.g. swap-out)
+     cannot starve readers; writes are still served after at most
+     WRITES_STARVED read batches.
+
+   All of them merge a new request into a queued request of the same
+   direction whose sectors are immediately before or after it, so
+   interleaved sequential streams turn into multi-sector commands. */
+
+/* Deadline tunables, in timer ticks. */
+#define READ_EXPIRE (TIMER_FREQ / 2)    /* 500 ms. */
+#define WRITE_EXPIRE (TIMER_FREQ * 5)   /* 5 s. */
+#define WRITES_STARVED 2                /* Read batches before a write. */
+
+static const struct iosched *const schedulers[] = {
+	&iosched_noop, &iosched_clook, &iosched_deadline, NULL,
+};
+
+/* Returns the scheduler called NAME, or a null pointer if there is
+   no such scheduler. */
+const struct iosched *
+iosched_find (const char *name) {
+	const struct iosched *const *s;
+
+	for (s = schedulers; *s != NULL; s++)
+		if (!strcmp ((*s)->name, name))
+			return *s;
+	return NULL;
+}
+
+/* Initializes Q as an empty queue scheduled by SCHED. */
+void
+iosched_queue_init (struct iosched_queue *q, const struct iosched *sched) {
+	ASSERT (sched != NULL);
+
+	q->sched = sched;
+	list_init (&q->sorted[0]);
+	list_init (&q->sorted[1]);
+	list_init (&q->fifo[0]);
+	list_init (&q->fifo[1]);
+	q->head = 0;
+	q->writes_starved = 0;
+	q->cnt = 0;
+	q->merge_cnt = 0;
+}
+
+/* Returns true if Q has no pending requests. */
+bool
+iosched_empty (const struct iosched_queue *q) {
+	return q->cnt == 0;
+}
+
+/* Orders requests by starting sector. */
+static bool
+request_less (const struct list_elem *a_, const struct list_elem *b_,
+		void *aux UNUSED) {
+	const struct disk_request *a = list_entry (a_, struct disk_request, elem);
+	const struct disk_request *b = list_entry (b_, struct disk_request, elem);
+
+	return a->sec_no < b->sec_no;
+}
+
+/* Tries to merge REQ into a queued request on LIST whose sectors are
+   adjacent to it.  IN_FIFO tells whether LIST's requests are also on a
+   FIFO list through their fifo_elem.  Returns true if REQ was merged,
+   in which case it must not be queued separately. */
+static bool
+merge (struct iosched_queue *q, struct list *list, struct disk_request *req,
+		bool in_fifo) {
+	struct list_elem *e;
+
+	for (e = list_begin (list); e != list_end (list); e = list_next (e)) {
+		struct disk_request *r = list_entry (e, struct disk_request, elem);
+
+		if (r->write != req->write
+				|| r->total_cnt + req->sec_cnt > IOSCHED_MAX_SECTORS)
+			continue;
+
+		if (r->sec_no + r->total_cnt == req->sec_no) {
+			/* Back merge: REQ continues R. */
+			list_push_back (&r->merged, &req->merge_elem);
+		} else if (req->sec_no + req->sec_cnt == r->sec_no) {
+			/* Front merge: REQ takes R's place and R (with everything
+			   merged into it) continues REQ. */
+			list_push_back (&req->merged, &r->merge_elem);
+			while (!list_empty (&r->merged))
+				list_push_back (&req->merged, list_pop_front (&r->merged));
+			req->total_cnt += r->total_cnt;
+			req->deadline = req->deadline < r->deadline
+				? req->deadline : r->deadline;
+			list_insert (&r->elem, &req->elem);
+			list_remove (&r->elem);
+			if (in_fifo) {
+				list_insert (&r->fifo_elem, &req->fifo_elem);
+				list_remove (&r->fifo_elem);
+			}
+			q->merge_cnt++;
+			return true;
+		} else
+			continue;
+
+		r->total_cnt += req->sec_cnt;
+		if (req->deadline < r->deadline)
+			r->deadline = req->deadline;
+		q->merge_cnt++;
+		return true;
+	}
+	return false;
+}
+
+/* Removes and returns the first request in LIST at or after Q's head
+   position, wrapping around to the lowest sector if there is none. */
+static struct disk_request *
+clook_pick (struct iosched_queue *q, struct list *list) {
+	struct list_elem *e;
+
+	if (list_empty (list))
+		return NULL;
+	for (e = list_begin (list); e != list_end (list); e = list_next (e))
+		if (list_entry (e, struct disk_request, elem)->sec_no >= q->head)
+			break;
+	if (e == list_end (list))
+		e = list_begin (list);
+	return list_entry (e, struct disk_request, elem);
+}
+
+/* No-op scheduler. */
+
+static void
+noop_add (struct iosched_queue *q, struct disk_request *req) {
+	if (!merge (q, &q->fifo[0], req, false)) {
+		list_push_back (&q->fifo[0], &req->elem);
+		q->cnt++;
+	}
+}
+
+static struct disk_request *
+noop_next (struct iosched_queue *q) {
+	struct disk_request *req;
+
+	if (list_empty (&q->fifo[0]))
+		return NULL;
+	req = list_entry (list_pop_front (&q->fifo[0]), struct disk_request, elem);
+	q->cnt--;
+	return req;
+}
+
+const struct iosched iosched_noop = {
+	.name = "noop",
+	.add = noop_add,
+	.next = noop_next,
+};
+
+/* C-LOOK elevator. */
+
+static void
+clook_add (struct iosched_queue *q, struct disk_request *req) {
+	if (!merge (q, &q->sorted[0], req, false)) {
+		list_insert_ordered (&q->sorted[0], &req->elem, request_less, NULL);
+		q->cnt++;
+	}
+}
+
+static struct disk_request *
+clook_next (struct iosched_queue *q) {
+	struct disk_request *req = clook_pick (q, &q->sorted[0]);
+
+	if (req != NULL) {
+		list_remove (&req->elem);
+		q->head = req->sec_no + req->total_cnt;
+		q->cnt--;
+	}
+	return req;
+}
+
+const struct iosched iosched_clook = {
+	.name = "clook",
+	.add = clook_add,
+	.next = clook_next,
+};
+
+/* Deadline. */
+
+static void
+deadline_add (struct iosched_queue *q, struct disk_request *req) {
+	int dir = req->write;
+
+	req->deadline = timer_ticks () + (req->write ? WRITE_EXPIRE : READ_EXPIRE);
+	if (!merge (q, &q->sorted[dir], req, true)) {
+		list_insert_ordered (&q->sorted[dir], &req->elem, request_less, NULL);
+		list_push_back (&q->fifo[dir], &req->fifo_elem);
+		q->cnt++;
+	}
+}
+
+static struct disk_request *
+deadline_next (struct iosched_queue *q) {
+	bool reads = !list_empty (&q->sorted[0]);
+	bool writes = !list_empty (&q->sorted[1]);
+	struct disk_request *req, *oldest;
+	int dir;
+
+	if (!reads && !writes)
+		return NULL;
+
+	/* Prefer reads, unless writes have waited long enough. */
+	if (reads && (!writes || q->writes_starved < WRITES_STARVED)) {
+		dir = 0;
+		q->writes_starved++;
+	} else {
+		dir = 1;
+		q->writes_starved = 0;
+	}
+
+	/* Serve the oldest request if it has expired, otherwise keep
+	   sweeping. */
+	oldest = list_entry (list_front (&q->fifo[dir]), struct disk_request,
+			fifo_elem);
+	if (oldest->deadline <= timer_ticks ())
+		req = oldest;
+	else
+		req = clook_pick (q, &q->sorted[dir]);
+
+	list_remove (&req->elem);
+	list_remove (&req->fifo_elem);
+	q->head = req->sec_no + req->total_cnt;
+	q->cnt--;
+	return req;
+}
+
+const struct iosched iosched_deadline = {
+	.name = "deadline",
+	.add = deadline_add,
+	.next = deadline_next,
+};
@@ -0,0 +1,105 @@
+#include "devices/ramdisk.h"
+#include <debug.h>
+#include <round.h>
+#include <string.h>
+#include "devices/disk.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* A disk kept in kernel memory.
+
+   It is registered like any other disk (see disk_register()), so it
+   can hold the file system or swap, and transfers are plain memory
+   copies.  That makes it useful for measuring the file system's own
+   CPU cost without the emulated disk in the way, and for scratch data
+   that does not need to survive a reboot.
+
+   Memory is allocated a page at a time, on the first write to a
+   page.  Sectors in pages that were never written read as zeros. */
+
+#define SECTORS_PER_PAGE (PGSIZE / DISK_SECTOR_SIZE)
+
+/* Size requested with -ramdisk, in sectors.  0 means no RAM disk. */
+static disk_sector_t ramdisk_sectors;
+
+/* The RAM disk. */
+static struct disk *ramdisk;
+static uint8_t **pages;             /* Backing pages, null until written. */
+static size_t page_cnt;             /* Number of elements in PAGES. */
+static struct lock alloc_lock;      /* Serializes page allocation. */
+
+static void ramdisk_submit (struct disk *, struct disk_request *);
+
+static const struct disk_driver ramdisk_driver = {
+	.type = "ram",
+	.submit = ramdisk_submit,
+};
+
+/* Asks for a RAM disk of KB kilobytes to be created by
+   ramdisk_init(). */
+void
+ramdisk_set_size (size_t kb) {
+	ramdisk_sectors = kb * (1024 / DISK_SECTOR_SIZE);
+}
+
+/* Creates and registers the RAM disk, if one was requested. */
+void
+ramdisk_init (void) {
+	if (ramdisk_sectors == 0)
+		return;
+
+	page_cnt = DIV_ROUND_UP (ramdisk_sectors, SECTORS_PER_PAGE);
+	pages = calloc (page_cnt, sizeof *pages);
+	if (pages == NULL)
+		PANIC ("ramdisk: out of memory");
+	lock_init (&alloc_lock);
+	ramdisk = disk_register (&ramdisk_driver, ramdisk_sectors, NULL);
+}
+
+/* Returns the memory that holds SEC_NO, allocating it if ALLOCATE
+   is true, or a null pointer if it has never been written and
+   ALLOCATE is false. */
+static uint8_t *
+sector_addr (disk_sector_t sec_no, bool allocate) {
+	size_t idx = sec_no / SECTORS_PER_PAGE;
+	size_t ofs = sec_no % SECTORS_PER_PAGE * DISK_SECTOR_SIZE;
+
+	ASSERT (idx < page_cnt);
+
+	if (pages[idx] == NULL && allocate) {
+		lock_acquire (&alloc_lock);
+		if (pages[idx] == NULL) {
+			pages[idx] = palloc_get_page (PAL_ZERO);
+			if (pages[idx] == NULL)
+				PANIC ("ramdisk: out of memory at sector %"PRDSNu, sec_no);
+		}
+		lock_release (&alloc_lock);
+	}
+	return pages[idx] != NULL ? pages[idx] + ofs : NULL;
+}
+
+/* Driver submit function.  Performs REQ on the spot and completes
+   it before returning. */
+static void
+ramdisk_submit (struct disk *d, struct disk_request *req) {
+	uint8_t *buffer = req->buffer;
+	size_t i;
+
+	ASSERT (!intr_context ());
+	ASSERT (list_empty (&req->merged));
+
+	for (i = 0; i < req->sec_cnt; i++, buffer += DISK_SECTOR_SIZE) {
+		uint8_t *sector = sector_addr (req->sec_no + i, req->write);
+
+		if (req->write)
+			memcpy (sector, buffer, DISK_SECTOR_SIZE);
+		else if (sector != NULL)
+			memcpy (buffer, sector, DISK_SECTOR_SIZE);
+		else
+			memset (buffer, 0, DISK_SECTOR_SIZE);
+	}
+	disk_complete (d, req);
+}
@@ -3,5 +3,8 @@ devices_SRC += devices/kbd.c		# Keyboard device.
 devices_SRC += devices/vga.c		# Video device.
 devices_SRC += devices/serial.c		# Serial port device.
 devices_SRC += devices/disk.c		# IDE disk device.
+devices_SRC += devices/iosched.c	# Disk I/O schedulers.
+devices_SRC += devices/virtio-blk.c	# virtio block device.
+devices_SRC += devices/ramdisk.c		# RAM disk.
 devices_SRC += devices/input.c		# Serial and keyboard input.
 devices_SRC += devices/intq.c		# Interrupt queue.
@@ -0,0 +1,472 @@
+#include "devices/virtio-blk.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdio.h>
+#include "devices/disk.h"
+#include "threads/interrupt.h"
+#include "threads/io.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Driver for virtio block devices ("legacy" virtio over PCI, as
+   QEMU provides with -drive if=virtio).
+
+   Unlike the ATA controller, a virtio disk takes many requests at
+   once: the driver places descriptor chains in a ring shared with
+   the device (the virtqueue), the device works on them in whatever
+   order it likes and reports each one in the "used" ring, raising an
+   interrupt.  Every request is one chain of a header, one descriptor
+   per page-contiguous piece of the data (scatter-gather) and a status
+   byte.  Requests are not sorted or merged here, since the host
+   already schedules them itself. */
+
+/* PCI configuration space access. */
+#define PCI_CONFIG_ADDRESS 0xcf8
+#define PCI_CONFIG_DATA 0xcfc
+#define PCI_REG_ID 0x00             /* Vendor and device ID. */
+#define PCI_REG_COMMAND 0x04        /* Command register. */
+#define PCI_REG_BAR0 0x10           /* Base address register 0. */
+#define PCI_REG_IRQ 0x3c            /* Interrupt line. */
+#define PCI_CMD_IO 0x01             /* Respond to I/O space accesses. */
+#define PCI_CMD_MASTER 0x04         /* Allow bus mastering (DMA). */
+
+#define VIRTIO_VENDOR 0x1af4        /* Red Hat, Inc. */
+#define VIRTIO_BLK_DEVICE 0x1001    /* Legacy block device. */
+
+/* Legacy virtio I/O registers, relative to BAR0. */
+#define reg_guest_features(VB) ((VB)->io_base + 0x04)
+#define reg_queue_pfn(VB) ((VB)->io_base + 0x08)
+#define reg_queue_size(VB) ((VB)->io_base + 0x0c)
+#define reg_queue_select(VB) ((VB)->io_base + 0x0e)
+#define reg_queue_notify(VB) ((VB)->io_base + 0x10)
+#define reg_status(VB) ((VB)->io_base + 0x12)
+#define reg_isr(VB) ((VB)->io_base + 0x13)
+#define reg_capacity(VB) ((VB)->io_base + 0x14)   /* 64 bits. */
+
+/* Device status bits. */
+#define STATUS_ACKNOWLEDGE 0x01     /* Guest noticed the device. */
+#define STATUS_DRIVER 0x02          /* Guest has a driver for it. */
+#define STATUS_DRIVER_OK 0x04       /* Driver is ready. */
+#define STATUS_FAILED 0x80          /* Driver gave up. */
+
+/* Virtqueue layout.  See the virtio 0.9.5 specification. */
+#define VRING_ALIGN PGSIZE
+#define VRING_DESC_F_NEXT 0x01      /* Chain continues in NEXT. */
+#define VRING_DESC_F_WRITE 0x02     /* Device writes (vs. reads) buffer. */
+
+struct vring_desc {
+	uint64_t addr;                  /* Physical address of buffer. */
+	uint32_t len;                   /* Length of buffer. */
+	uint16_t flags;                 /* VRING_DESC_F_*. */
+	uint16_t next;                  /* Next descriptor in chain. */
+};
+
+struct vring_avail {
+	uint16_t flags;
+	uint16_t idx;                   /* Where the driver puts the next entry. */
+	uint16_t ring[];                /* Heads of available chains. */
+};
+
+struct vring_used_elem {
+	uint32_t id;                    /* Head of completed chain. */
+	uint32_t len;                   /* Bytes written by the device. */
+};
+
+struct vring_used {
+	uint16_t flags;
+	uint16_t idx;                   /* Where the device puts the next entry. */
+	struct vring_used_elem ring[];  /* Completed chains. */
+};
+
+/* Block request header and status. */
+#define VIRTIO_BLK_T_IN 0           /* Read. */
+#define VIRTIO_BLK_T_OUT 1          /* Write. */
+#define VIRTIO_BLK_S_OK 0           /* Success. */
+
+struct virtio_blk_header {
+	uint32_t type;                  /* VIRTIO_BLK_T_*. */
+	uint32_t reserved;
+	uint64_t sector;                /* First sector. */
+};
+
+/* What the device reads and writes besides the data of an
+   in-flight request, indexed by the request's first descriptor.
+   The size is a power of 2, so that none crosses a page boundary. */
+struct vblk_slot {
+	struct virtio_blk_header header;
+	struct disk_request *req;       /* Request being served. */
+	uint8_t status;                 /* VIRTIO_BLK_S_*, from the device. */
+};
+
+/* A virtio block device. */
+struct virtio_blk {
+	struct list_elem elem;          /* Element in devices. */
+	struct disk *disk;              /* Corresponding disk. */
+	uint16_t io_base;               /* Base I/O port. */
+	uint8_t irq;                    /* Interrupt in use. */
+
+	uint16_t qsize;                 /* Number of descriptors. */
+	struct vring_desc *desc;        /* Descriptor table. */
+	struct vring_avail *avail;      /* Available ring. */
+	struct vring_used *used;        /* Used ring. */
+	uint16_t last_used;             /* Next used entry to process. */
+	uint16_t free_head;             /* First free descriptor. */
+	uint16_t free_cnt;              /* Number of free descriptors. */
+	struct vblk_slot *slots;        /* One per descriptor. */
+
+	struct list pending;            /* Requests waiting for descriptors. */
+};
+
+/* All virtio block devices. */
+static struct list devices;
+
+/* Interrupt vectors we have registered a handler for, as a mask of
+   IRQ lines.  Devices may share a line. */
+static uint16_t registered_irqs;
+
+static void probe (int bus, int slot);
+static bool setup_queue (struct virtio_blk *);
+static void virtio_blk_submit (struct disk *, struct disk_request *);
+static bool post_request (struct virtio_blk *, struct disk_request *);
+static void post_pending (struct virtio_blk *);
+static void interrupt_handler (struct intr_frame *);
+
+static const struct disk_driver virtio_blk_driver = {
+	.type = "virtio",
+	.submit = virtio_blk_submit,
+};
+
+/* Reads the 32-bit PCI configuration register REG of function 0 of
+   the device in SLOT on BUS. */
+static uint32_t
+pci_read (int bus, int slot, int reg) {
+	outl (PCI_CONFIG_ADDRESS,
+			0x80000000 | bus << 16 | slot << 11 | (reg & 0xfc));
+	return inl (PCI_CONFIG_DATA);
+}
+
+/* Writes DATA to PCI configuration register REG, as pci_read(). */
+static void
+pci_write (int bus, int slot, int reg, uint32_t data) {
+	outl (PCI_CONFIG_ADDRESS,
+			0x80000000 | bus << 16 | slot << 11 | (reg & 0xfc));
+	outl (PCI_CONFIG_DATA, data);
+}
+
+/* Finds the virtio block devices on the PCI bus and registers a
+   disk for each one.  Only bus 0 is scanned, which is where QEMU's
+   PC machine puts its devices. */
+void
+virtio_blk_init (void) {
+	int slot;
+
+	ASSERT (sizeof (struct vblk_slot) == 32);
+
+	list_init (&devices);
+	for (slot = 0; slot < 32; slot++) {
+		uint32_t id = pci_read (0, slot, PCI_REG_ID);
+		if ((id & 0xffff) == VIRTIO_VENDOR && id >> 16 == VIRTIO_BLK_DEVICE)
+			probe (0, slot);
+	}
+}
+
+/* Initializes the virtio block device in SLOT on BUS. */
+static void
+probe (int bus, int slot) {
+	uint32_t bar0 = pci_read (bus, slot, PCI_REG_BAR0);
+	uint8_t irq_line = pci_read (bus, slot, PCI_REG_IRQ) & 0xff;
+	struct virtio_blk *vb;
+	uint64_t capacity;
+
+	if (!(bar0 & 1) || irq_line >= 16) {
+		printf ("virtio-blk %02x:%02x: no I/O ports or IRQ, ignored\n",
+				bus, slot);
+		return;
+	}
+
+	vb = calloc (1, sizeof *vb);
+	if (vb == NULL)
+		return;
+	vb->io_base = bar0 & ~3u;
+	vb->irq = irq_line + 0x20;
+	list_init (&vb->pending);
+
+	/* Enable the device and reset it. */
+	pci_write (bus, slot, PCI_REG_COMMAND,
+			pci_read (bus, slot, PCI_REG_COMMAND) | PCI_CMD_IO | PCI_CMD_MASTER);
+	outb (reg_status (vb), 0);
+	outb (reg_status (vb), STATUS_ACKNOWLEDGE);
+	outb (reg_status (vb), STATUS_ACKNOWLEDGE | STATUS_DRIVER);
+
+	/* We need none of the optional features. */
+	outl (reg_guest_features (vb), 0);
+
+	if (!setup_queue (vb)) {
+		outb (reg_status (vb), STATUS_FAILED);
+		free (vb);
+		return;
+	}
+
+	if (!(registered_irqs & (1u << irq_line))) {
+		registered_irqs |= 1u << irq_line;
+		intr_register_ext (vb->irq, interrupt_handler, "virtio-blk");
+	}
+	list_push_back (&devices, &vb->elem);
+
+	capacity = inl (reg_capacity (vb))
+		| (uint64_t) inl (reg_capacity (vb) + 4) << 32;
+	if (capacity > UINT32_MAX)
+		capacity = UINT32_MAX;
+	vb->disk = disk_register (&virtio_blk_driver, capacity, vb);
+
+	outb (reg_status (vb),
+			STATUS_ACKNOWLEDGE | STATUS_DRIVER | STATUS_DRIVER_OK);
+}
+
+/* Allocates and announces VB's request virtqueue.  Returns false if
+   the device has no queue or memory is short. */
+static bool
+setup_queue (struct virtio_blk *vb) {
+	size_t avail_end, used_ofs, ring_size, slot_pages;
+	uint8_t *ring;
+	uint16_t i;
+
+	outw (reg_queue_select (vb), 0);
+	vb->qsize = inw (reg_queue_size (vb));
+	if (vb->qsize == 0)
+		return false;
+
+	/* The descriptor table and available ring come first, then the
+	   used ring on the next aligned boundary. */
+	avail_end = sizeof (struct vring_desc) * vb->qsize
+		+ sizeof (uint16_t) * (3 + vb->qsize);
+	used_ofs = ROUND_UP (avail_end, VRING_ALIGN);
+	ring_size = used_ofs + ROUND_UP (sizeof (uint16_t) * 3
+			+ sizeof (struct vring_used_elem) * vb->qsize, VRING_ALIGN);
+	slot_pages = DIV_ROUND_UP (sizeof (struct vblk_slot) * vb->qsize, PGSIZE);
+
+	ring = palloc_get_multiple (PAL_ZERO, ring_size / PGSIZE);
+	vb->slots = palloc_get_multiple (PAL_ZERO, slot_pages);
+	if (ring == NULL || vb->slots == NULL) {
+		palloc_free_multiple (ring, ring_size / PGSIZE);
+		palloc_free_multiple (vb->slots, slot_pages);
+		return false;
+	}
+
+	vb->desc = (struct vring_desc *) ring;
+	vb->avail = (struct vring_avail *) (ring
+			+ sizeof (struct vring_desc) * vb->qsize);
+	vb->used = (struct vring_used *) (ring + used_ofs);
+	vb->last_used = 0;
+
+	for (i = 0; i < vb->qsize; i++)
+		vb->desc[i].next = i + 1;
+	vb->free_head = 0;
+	vb->free_cnt = vb->qsize;
+
+	outl (reg_queue_pfn (vb), vtop (ring) >> 12);
+	return true;
+}
+
+/* Returns the number of descriptors needed to transfer REQ: one
+   per page-contiguous piece of each buffer, plus header and
+   status. */
+static size_t
+desc_count (struct disk_request *req) {
+	struct list_elem *e;
+	struct disk_request *r = req;
+	size_t cnt = 2;
+
+	for (e = list_head (&req->merged); r != NULL; ) {
+		uintptr_t start = (uintptr_t) r->buffer;
+		uintptr_t end = start + r->sec_cnt * DISK_SECTOR_SIZE;
+		cnt += DIV_ROUND_UP (end, PGSIZE) - start / PGSIZE;
+
+		e = list_next (e);
+		r = e != list_end ((struct list *) &req->merged)
+			? list_entry (e, struct disk_request, merge_elem) : NULL;
+	}
+	return cnt;
+}
+
+/* Takes a descriptor off VB's free list and returns its index. */
+static uint16_t
+alloc_desc (struct virtio_blk *vb) {
+	uint16_t i = vb->free_head;
+
+	ASSERT (vb->free_cnt > 0);
+	vb->free_head = vb->desc[i].next;
+	vb->free_cnt--;
+	return i;
+}
+
+/* Appends a descriptor for the SIZE bytes at kernel address BUFFER,
+   which must not cross a page boundary, to the chain ending at
+   descriptor *PREV, and makes it the new end of the chain.  Kernel
+   memory is resident and mapped one-to-one onto physical memory, so
+   vtop() gives the device an address it can DMA to. */
+static void
+chain_desc (struct virtio_blk *vb, uint16_t *prev, void *buffer,
+		size_t size, uint16_t flags) {
+	uint16_t i = alloc_desc (vb);
+
+	vb->desc[*prev].flags |= VRING_DESC_F_NEXT;
+	vb->desc[*prev].next = i;
+	vb->desc[i].addr = vtop (buffer);
+	vb->desc[i].len = size;
+	vb->desc[i].flags = flags;
+	vb->desc[i].next = 0;
+	*prev = i;
+}
+
+/* Driver submit function.  Posts REQ to the device right away if
+   there are descriptors to spare, or queues it until there are. */
+static void
+virtio_blk_submit (struct disk *d, struct disk_request *req) {
+	struct virtio_blk *vb = disk_driver_data (d);
+	enum intr_level old_level;
+
+	/* The device reads and writes the buffer by DMA, long after the
+	   requester's address space may have changed.  The file system
+	   stages user buffers through kernel pages before they get here. */
+	ASSERT (is_kernel_vaddr (req->buffer));
+
+	old_level = intr_disable ();
+	if (list_empty (&vb->pending) && post_request (vb, req))
+		outw (reg_queue_notify (vb), 0);
+	else
+		list_push_back (&vb->pending, &req->elem);
+	intr_set_level (old_level);
+}
+
+/* Places REQ on VB's virtqueue, without notifying the device.
+   Returns false if there are not enough free descriptors.
+   Must be called with interrupts off. */
+static bool
+post_request (struct virtio_blk *vb, struct disk_request *req) {
+	uint16_t data_flags = req->write ? 0 : VRING_DESC_F_WRITE;
+	size_t need = desc_count (req);
+	struct list_elem *e;
+	struct disk_request *r;
+	struct vblk_slot *slot;
+	uint16_t head, prev;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (need <= vb->qsize);
+
+	if (need > vb->free_cnt)
+		return false;
+
+	/* Header. */
+	head = prev = alloc_desc (vb);
+	slot = &vb->slots[head];
+	slot->header.type = req->write ? VIRTIO_BLK_T_OUT : VIRTIO_BLK_T_IN;
+	slot->header.reserved = 0;
+	slot->header.sector = req->sec_no;
+	slot->req = req;
+	slot->status = 0xff;
+	vb->desc[head].addr = vtop (&slot->header);
+	vb->desc[head].len = sizeof slot->header;
+	vb->desc[head].flags = 0;
+
+	/* Data, split at page boundaries. */
+	for (r = req, e = list_head (&req->merged); r != NULL; ) {
+		uint8_t *buffer = r->buffer;
+		size_t left = r->sec_cnt * DISK_SECTOR_SIZE;
+
+		while (left > 0) {
+			size_t chunk = PGSIZE - pg_ofs (buffer);
+			if (chunk > left)
+				chunk = left;
+			chain_desc (vb, &prev, buffer, chunk, data_flags);
+			buffer += chunk;
+			left -= chunk;
+		}
+
+		e = list_next (e);
+		r = e != list_end (&req->merged)
+			? list_entry (e, struct disk_request, merge_elem) : NULL;
+	}
+
+	/* Status. */
+	chain_desc (vb, &prev, &slot->status, 1, VRING_DESC_F_WRITE);
+
+	/* Make the chain visible before publishing it. */
+	vb->avail->ring[vb->avail->idx % vb->qsize] = head;
+	barrier ();
+	vb->avail->idx++;
+	barrier ();
+	return true;
+}
+
+/* Posts as many of VB's pending requests as fit in the virtqueue. */
+static void
+post_pending (struct virtio_blk *vb) {
+	bool posted = false;
+
+	while (!list_empty (&vb->pending)) {
+		struct disk_request *req = list_entry (list_front (&vb->pending),
+				struct disk_request, elem);
+		if (!post_request (vb, req))
+			break;
+		list_pop_front (&vb->pending);
+		posted = true;
+	}
+	if (posted)
+		outw (reg_queue_notify (vb), 0);
+}
+
+/* Returns the descriptor chain starting at HEAD to VB's free list. */
+static void
+free_chain (struct virtio_blk *vb, uint16_t head) {
+	uint16_t i = head;
+
+	for (;;) {
+		uint16_t flags = vb->desc[i].flags;
+		uint16_t next = vb->desc[i].next;
+
+		vb->desc[i].next = vb->free_head;
+		vb->free_head = i;
+		vb->free_cnt++;
+		if (!(flags & VRING_DESC_F_NEXT))
+			break;
+		i = next;
+	}
+}
+
+/* Completes every request that VB's device has finished. */
+static void
+reap_requests (struct virtio_blk *vb) {
+	while (vb->last_used != *(volatile uint16_t *) &vb->used->idx) {
+		struct vring_used_elem *u = &vb->used->ring[vb->last_used % vb->qsize];
+		struct vblk_slot *slot = &vb->slots[u->id];
+		struct disk_request *req = slot->req;
+
+		barrier ();
+		if (slot->status != VIRTIO_BLK_S_OK)
+			PANIC ("virtio-blk: disk %s failed, sector=%"PRDSNu,
+					req->write ? "write" : "read", req->sec_no);
+		free_chain (vb, u->id);
+		vb->last_used++;
+		disk_complete (vb->disk, req);
+	}
+}
+
+/* virtio-blk interrupt handler. */
+static void
+interrupt_handler (struct intr_frame *f) {
+	struct list_elem *e;
+
+	for (e = list_begin (&devices); e != list_end (&devices); e = list_next (e)) {
+		struct virtio_blk *vb = list_entry (e, struct virtio_blk, elem);
+
+		/* Reading the ISR acknowledges the interrupt. */
+		if (vb->irq != f->vec_no || !(inb (reg_isr (vb)) & 1))
+			continue;
+		reap_requests (vb);
+		post_pending (vb);
+	}
+}
@@ -0,0 +1,701 @@
+/* buffer_cache.c: Sector-granularity buffer cache. */
+
+#include "filesys/buffer_cache.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "filesys/journal.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* A small, fixed set of sector buffers shared by everything that
+   goes through it, so its memory use does not depend on the size of
+   the disk.
+
+   A user pins the block for a sector, which reads the sector in if
+   it is not cached, works on the data, marks the block dirty if it
+   changed it, and unpins it.  Pinned blocks are never evicted; the
+   others are replaced in clock order.  Dirty blocks are written back
+   when they are evicted, by the flusher thread every few seconds, or
+   on demand through buffer_cache_flush_range().
+
+   buffer_cache_sync() and buffer_cache_sync_ranges() are the entry
+   points for sync() and fsync().  They group-commit: callers that
+   arrive while a flush is running wait for it to end and then share a
+   single commit and a single round of disk writes between them, so a
+   burst of small synchronous writers pays for one round instead of
+   one each.
+
+   Blocks of the disk with the journal are never written home before
+   their contents are committed to the journal.  Each change belongs
+   to the running transaction; commit() waits for a moment when no
+   block is pinned, so that the cache holds a consistent picture,
+   copies the blocks changed since the last commit into a journal
+   transaction and starts a new one.  Once that transaction is on
+   disk, the blocks may be written home, which happens lazily, on
+   eviction or unmount.  Durability then costs one sequential log
+   write, and the flusher commits instead of writing home. */
+
+/* Number of cached sectors. */
+#define CACHE_SIZE 64
+
+/* How often the flusher writes back dirty blocks, in ticks. */
+#define FLUSH_INTERVAL (5 * TIMER_FREQ)
+
+struct cache_block {
+	struct hash_elem elem;              /* Element in blocks_by_sector. */
+	struct disk *disk;                  /* Disk, or null if unused. */
+	disk_sector_t sector;               /* Sector on DISK. */
+	int pin_cnt;                        /* Number of users. */
+	bool accessed;                      /* Used since the clock hand passed? */
+	bool dirty;                         /* Changed since last written? */
+	bool loading;                       /* Being read in? */
+	bool writing;                       /* Being written back? */
+	uint64_t seq;                       /* Transaction of latest change. */
+	struct disk_request req;            /* For writing back. */
+	uint8_t data[DISK_SECTOR_SIZE];     /* Sector contents. */
+};
+
+static struct cache_block blocks[CACHE_SIZE];
+static struct hash blocks_by_sector;    /* Blocks in use. */
+static size_t clock_hand;               /* Next eviction candidate. */
+
+/* Protects all of the above except block data. */
+static struct lock cache_lock;
+static struct condition io_done;        /* Some block finished I/O. */
+static struct condition unpinned;       /* Some block became unpinned. */
+
+/* A caller of buffer_cache_sync() or buffer_cache_sync_ranges()
+   waiting for its changes to become durable. */
+struct sync_request {
+	struct list_elem elem;              /* Element in sync_queue. */
+	struct disk *disk;                  /* Disk, or null for every disk. */
+	const struct sector_range *ranges;  /* Sectors of DISK. */
+	size_t range_cnt;                   /* Number of RANGES. */
+	bool done;                          /* Durable yet? */
+};
+
+/* Group commit state. */
+static struct lock sync_lock;
+static struct condition sync_done;      /* A sync flush finished. */
+static struct list sync_queue;          /* Requests not yet started. */
+static bool syncing;                    /* A sync flush is running? */
+
+/* Journal transactions, protected by cache_lock.  Commits are
+   serialized by commit_lock, which is acquired before cache_lock. */
+static struct lock commit_lock;
+static struct condition commit_done;    /* COMMIT_PENDING became false. */
+static bool commit_pending;             /* Commit waiting for a snapshot? */
+static size_t user_pins;                /* Pins held outside this file. */
+static uint64_t running_seq = 1;        /* Transaction taking changes. */
+static uint64_t committed_seq;          /* Last transaction on disk. */
+
+static uint64_t block_hash (const struct hash_elem *, void *aux);
+static bool block_less (const struct hash_elem *, const struct hash_elem *,
+		void *aux);
+static void flusher (void *aux);
+static void commit (void);
+
+/* Initializes the buffer cache and starts its flusher. */
+void
+buffer_cache_init (void) {
+	lock_init (&cache_lock);
+	cond_init (&io_done);
+	cond_init (&unpinned);
+	lock_init (&sync_lock);
+	cond_init (&sync_done);
+	list_init (&sync_queue);
+	lock_init (&commit_lock);
+	cond_init (&commit_done);
+	ASSERT (CACHE_SIZE <= JOURNAL_MAX_BLOCKS);
+	hash_init (&blocks_by_sector, block_hash, block_less, NULL);
+	thread_create ("cache-flush", PRI_DEFAULT, flusher, NULL);
+}
+
+/* Returns the block caching SECTOR of disk D, or a null pointer. */
+static struct cache_block *
+lookup (struct disk *d, disk_sector_t sector) {
+	struct cache_block key;
+	struct hash_elem *e;
+
+	key.disk = d;
+	key.sector = sector;
+	e = hash_find (&blocks_by_sector, &key.elem);
+	return e != NULL ? hash_entry (e, struct cache_block, elem) : NULL;
+}
+
+/* Returns true if B is journaled and has changes that are not
+   committed yet, so that it must not be written home. */
+static bool
+uncommitted (const struct cache_block *b) {
+	return b->dirty && b->disk != NULL && b->disk == journal_disk ()
+	       && b->seq > committed_seq;
+}
+
+/* Chooses a block to evict: an unused block, or else the first
+   unpinned, committed block not accessed since the clock hand last
+   passed it.  Returns a null pointer if there is none. */
+static struct cache_block *
+choose_victim (void) {
+	size_t i;
+
+	for (i = 0; i < 2 * CACHE_SIZE; i++) {
+		struct cache_block *b = &blocks[clock_hand];
+
+		clock_hand = (clock_hand + 1) % CACHE_SIZE;
+		if (b->disk == NULL)
+			return b;
+		if (b->pin_cnt > 0 || uncommitted (b))
+			continue;
+		if (b->accessed)
+			b->accessed = false;
+		else
+			return b;
+	}
+	return NULL;
+}
+
+/* Writes back dirty block B.  Releases the cache lock during the
+   write. */
+static void
+write_back (struct cache_block *b) {
+	ASSERT (lock_held_by_current_thread (&cache_lock));
+	ASSERT (b->dirty && !b->writing);
+
+	b->pin_cnt++;
+	b->writing = true;
+	b->dirty = false;
+	lock_release (&cache_lock);
+
+	disk_write (b->disk, b->sector, b->data);
+
+	lock_acquire (&cache_lock);
+	b->writing = false;
+	b->pin_cnt--;
+	cond_broadcast (&io_done, &cache_lock);
+	cond_broadcast (&unpinned, &cache_lock);
+}
+
+/* Returns true if some unpinned block only waits for a commit to
+   become evictable. */
+static bool
+commit_would_help (void) {
+	size_t i;
+
+	for (i = 0; i < CACHE_SIZE; i++)
+		if (blocks[i].pin_cnt == 0 && uncommitted (&blocks[i]))
+			return true;
+	return false;
+}
+
+/* Does the work of buffer_cache_pin(), and also stores in *HIT
+   whether the sector was cached already. */
+static struct cache_block *
+pin (struct disk *d, disk_sector_t sector, bool load, bool *hit) {
+	struct cache_block *b;
+
+	ASSERT (d != NULL);
+
+	lock_acquire (&cache_lock);
+	for (;;) {
+		/* No new pins while a commit waits for a snapshot. */
+		while (commit_pending)
+			cond_wait (&commit_done, &cache_lock);
+
+		b = lookup (d, sector);
+		if (b != NULL) {
+			b->pin_cnt++;
+			b->accessed = true;
+			user_pins++;
+			while (b->loading)
+				cond_wait (&io_done, &cache_lock);
+			lock_release (&cache_lock);
+			*hit = true;
+			return b;
+		}
+
+		b = choose_victim ();
+		if (b == NULL && commit_would_help ()) {
+			lock_release (&cache_lock);
+			commit ();
+			lock_acquire (&cache_lock);
+		} else if (b == NULL)
+			cond_wait (&unpinned, &cache_lock);
+		else if (b->dirty)
+			write_back (b);
+		else
+			break;
+	}
+	*hit = false;
+
+	/* Take over the victim. */
+	if (b->disk != NULL)
+		hash_delete (&blocks_by_sector, &b->elem);
+	b->disk = d;
+	b->sector = sector;
+	b->pin_cnt = 1;
+	b->accessed = true;
+	b->dirty = false;
+	hash_insert (&blocks_by_sector, &b->elem);
+	user_pins++;
+
+	if (!load) {
+		memset (b->data, 0, DISK_SECTOR_SIZE);
+		lock_release (&cache_lock);
+		return b;
+	}
+
+	b->loading = true;
+	lock_release (&cache_lock);
+
+	disk_read (d, sector, b->data);
+
+	lock_acquire (&cache_lock);
+	b->loading = false;
+	cond_broadcast (&io_done, &cache_lock);
+	lock_release (&cache_lock);
+	return b;
+}
+
+/* Pins and returns the block that caches SECTOR of disk D.  If the
+   sector is not cached yet, its contents are read from disk if LOAD
+   is true, or else zeroed (for callers that will overwrite all of
+   it).  Every pin must be paired with buffer_cache_unpin(), and a
+   thread must not hold more than one pin at a time. */
+struct cache_block *
+buffer_cache_pin (struct disk *d, disk_sector_t sector, bool load) {
+	bool hit;
+
+	return pin (d, sector, load, &hit);
+}
+
+/* Returns the DISK_SECTOR_SIZE bytes of data in pinned block B. */
+void *
+buffer_cache_data (struct cache_block *b) {
+	ASSERT (b->pin_cnt > 0);
+
+	return b->data;
+}
+
+/* Records that pinned block B's data has been changed. */
+void
+buffer_cache_mark_dirty (struct cache_block *b) {
+	ASSERT (b->pin_cnt > 0);
+
+	lock_acquire (&cache_lock);
+	b->dirty = true;
+	if (b->disk == journal_disk ()) {
+		b->seq = running_seq;
+		journal_unrevoke (b->sector);
+	}
+	lock_release (&cache_lock);
+}
+
+/* Releases a pin on B obtained with buffer_cache_pin(). */
+void
+buffer_cache_unpin (struct cache_block *b) {
+	lock_acquire (&cache_lock);
+	ASSERT (b->pin_cnt > 0);
+	ASSERT (user_pins > 0);
+	user_pins--;
+	if (--b->pin_cnt == 0 || user_pins == 0)
+		cond_broadcast (&unpinned, &cache_lock);
+	lock_release (&cache_lock);
+}
+
+/* Copies SIZE bytes starting at byte OFS of SECTOR of disk D into
+   BUFFER, through the cache. */
+void
+buffer_cache_read (struct disk *d, disk_sector_t sector, void *buffer,
+		size_t ofs, size_t size) {
+	struct cache_block *b = buffer_cache_pin (d, sector, true);
+
+	ASSERT (ofs + size <= DISK_SECTOR_SIZE);
+	memcpy (buffer, b->data + ofs, size);
+	buffer_cache_unpin (b);
+}
+
+/* Copies SIZE bytes from BUFFER to byte OFS of SECTOR of disk D,
+   through the cache.  If FRESH, the sector holds nothing worth
+   reading and the rest of it becomes zeros.  Rewriting a cached
+   sector with the same bytes does not dirty it. */
+void
+buffer_cache_write (struct disk *d, disk_sector_t sector,
+		const void *buffer, size_t ofs, size_t size, bool fresh) {
+	bool whole = ofs == 0 && size == DISK_SECTOR_SIZE;
+	struct cache_block *b;
+	bool hit;
+
+	ASSERT (ofs + size <= DISK_SECTOR_SIZE);
+	b = pin (d, sector, !fresh && !whole, &hit);
+	if (fresh || !hit || memcmp (b->data + ofs, buffer, size)) {
+		memcpy (b->data + ofs, buffer, size);
+		buffer_cache_mark_dirty (b);
+	}
+	buffer_cache_unpin (b);
+}
+
+/* Drops the cached copies of sectors START (inclusive) through END
+   (exclusive) of disk D, which have been freed, without writing them
+   back, and revokes any copies of them in the journal. */
+void
+buffer_cache_discard (struct disk *d, disk_sector_t start,
+		disk_sector_t end) {
+	disk_sector_t sector;
+	size_t i;
+
+	lock_acquire (&cache_lock);
+	for (i = 0; i < CACHE_SIZE; i++) {
+		struct cache_block *b = &blocks[i];
+
+		if (b->disk != d || b->sector < start || b->sector >= end)
+			continue;
+		while (b->disk == d && (b->pin_cnt > 0 || b->writing || b->loading))
+			cond_wait (&unpinned, &cache_lock);
+		if (b->disk != d || b->sector < start || b->sector >= end)
+			continue;
+		hash_delete (&blocks_by_sector, &b->elem);
+		b->disk = NULL;
+		b->dirty = false;
+	}
+	if (d == journal_disk ())
+		for (sector = start; sector < end; sector++)
+			journal_revoke (sector);
+	lock_release (&cache_lock);
+}
+
+/* Writes back the dirty blocks for which WANTED returns true, given
+   AUX, and waits until they are on disk.
+
+   All of the writes are started before any is waited for, in sector
+   order, so that the disk's scheduler can merge adjacent sectors
+   into multi-sector transfers. */
+static void
+flush_blocks (bool (*wanted) (const struct cache_block *, void *aux),
+		void *aux) {
+	struct cache_block *batch[CACHE_SIZE];
+	size_t cnt, i, j;
+	bool busy;
+
+	lock_acquire (&cache_lock);
+	do {
+		cnt = 0;
+		busy = false;
+		for (i = 0; i < CACHE_SIZE; i++) {
+			struct cache_block *b = &blocks[i];
+
+			if (b->disk == NULL || !wanted (b, aux))
+				continue;
+			if (b->writing) {
+				/* Someone else is writing it; wait for them below. */
+				busy = true;
+				continue;
+			}
+			if (!b->dirty || b->loading || uncommitted (b))
+				continue;
+
+			b->pin_cnt++;
+			b->writing = true;
+			b->dirty = false;
+
+			/* Insert in sector order. */
+			for (j = cnt++; j > 0 && batch[j - 1]->sector > b->sector; j--)
+				batch[j] = batch[j - 1];
+			batch[j] = b;
+		}
+		lock_release (&cache_lock);
+
+		for (i = 0; i < cnt; i++)
+			disk_write_async (batch[i]->disk, batch[i]->sector, 1,
+					batch[i]->data, &batch[i]->req, NULL, NULL);
+		for (i = 0; i < cnt; i++)
+			disk_wait (&batch[i]->req);
+
+		lock_acquire (&cache_lock);
+		for (i = 0; i < cnt; i++) {
+			batch[i]->writing = false;
+			batch[i]->pin_cnt--;
+		}
+		if (cnt > 0) {
+			cond_broadcast (&io_done, &cache_lock);
+			cond_broadcast (&unpinned, &cache_lock);
+		}
+		if (busy)
+			cond_wait (&io_done, &cache_lock);
+	} while (busy);
+	lock_release (&cache_lock);
+}
+
+/* Blocks for flush(). */
+struct flush_range {
+	struct disk *disk;                  /* Disk, or null for all but SKIP. */
+	struct disk *skip;                  /* Disk to leave alone, or null. */
+	disk_sector_t start, end;           /* Sectors, END exclusive. */
+};
+
+/* Returns true if block B is in the flush_range RANGE_. */
+static bool
+in_flush_range (const struct cache_block *b, void *range_) {
+	const struct flush_range *range = range_;
+
+	return (range->disk == NULL || b->disk == range->disk)
+		&& (range->skip == NULL || b->disk != range->skip)
+		&& b->sector >= range->start && b->sector < range->end;
+}
+
+/* Writes back the dirty blocks for sectors START (inclusive) through
+   END (exclusive) of disk D, or of every disk but SKIP if D is null,
+   and waits until they are on disk. */
+static void
+flush (struct disk *d, struct disk *skip, disk_sector_t start,
+		disk_sector_t end) {
+	struct flush_range range = { d, skip, start, end };
+
+	flush_blocks (in_flush_range, &range);
+}
+
+/* Waits until no block of the journal disk is being written home.  A
+   full commit moves the start of the log past every older
+   transaction, so a block whose home write is still in flight would
+   otherwise be lost if the system crashed before it finished.  Must
+   be called with CACHE_LOCK held. */
+static void
+wait_home_writes (void) {
+	size_t i;
+
+	for (i = 0; i < CACHE_SIZE; i++)
+		if (blocks[i].writing && blocks[i].disk == journal_disk ()) {
+			/* flush() may have started others meanwhile: rescan. */
+			cond_wait (&io_done, &cache_lock);
+			i = -1;
+		}
+}
+
+/* Commits the running transaction to the journal, if there is one,
+   and waits until it is on disk. */
+static void
+commit (void) {
+	disk_sector_t sectors[CACHE_SIZE];
+	size_t cnt = 0, i;
+	uint64_t seq;
+	bool full, any;
+
+	if (journal_disk () == NULL)
+		return;
+
+	lock_acquire (&commit_lock);
+	lock_acquire (&cache_lock);
+	commit_pending = true;
+	while (user_pins > 0)
+		cond_wait (&unpinned, &cache_lock);
+
+	/* Nobody is in the middle of changing a block, so the blocks
+	   changed since the last commit form a consistent update.  If the
+	   log is running out of room, log every dirty block instead, so
+	   that the log can start over here. */
+	for (i = 0; i < CACHE_SIZE; i++)
+		if (uncommitted (&blocks[i]))
+			cnt++;
+	full = journal_need_full (cnt);
+	if (full)
+		wait_home_writes ();
+	cnt = 0;
+	for (i = 0; i < CACHE_SIZE; i++) {
+		struct cache_block *b = &blocks[i];
+
+		if (!b->dirty || b->disk != journal_disk ()
+				|| (!full && !uncommitted (b)))
+			continue;
+		memcpy (journal_slot (cnt), b->data, DISK_SECTOR_SIZE);
+		sectors[cnt++] = b->sector;
+		b->seq = running_seq;
+	}
+	any = journal_prepare (sectors, cnt, full);
+	seq = running_seq++;
+	commit_pending = false;
+	cond_broadcast (&commit_done, &cache_lock);
+	lock_release (&cache_lock);
+
+	if (any)
+		journal_write ();
+
+	lock_acquire (&cache_lock);
+	committed_seq = seq;
+	cond_broadcast (&unpinned, &cache_lock);
+	lock_release (&cache_lock);
+	lock_release (&commit_lock);
+}
+
+/* Writes back the cached dirty sectors START (inclusive) through END
+   (exclusive) of disk D. */
+void
+buffer_cache_flush_range (struct disk *d, disk_sector_t start,
+		disk_sector_t end) {
+	ASSERT (d != NULL);
+
+	commit ();
+	flush (d, NULL, start, end);
+}
+
+/* Writes back every dirty block.  If nothing was changed meanwhile,
+   the journal is then empty. */
+void
+buffer_cache_flush (void) {
+	size_t i;
+
+	commit ();
+	flush (NULL, NULL, 0, UINT32_MAX);
+
+	lock_acquire (&commit_lock);
+	lock_acquire (&cache_lock);
+	for (i = 0; i < CACHE_SIZE; i++)
+		if (blocks[i].dirty && blocks[i].disk == journal_disk ())
+			break;
+	if (i == CACHE_SIZE)
+		journal_checkpoint ();
+	lock_release (&cache_lock);
+	lock_release (&commit_lock);
+}
+
+/* Makes every change made to a block so far durable and waits until
+   it is on disk.  Changes to the journaled disk are committed to the
+   journal; those to other disks, which have no journal, are written
+   back. */
+static void
+sync_all (void) {
+	if (journal_disk () != NULL) {
+		commit ();
+		flush (NULL, journal_disk (), 0, UINT32_MAX);
+	} else
+		buffer_cache_flush ();
+}
+
+/* Returns true if block B must be written home for one of the
+   sync_requests in the list BATCH_.  Blocks of the journaled disk
+   never need to be: committing them made them durable. */
+static bool
+requested (const struct cache_block *b, void *batch_) {
+	struct list *batch = batch_;
+	struct list_elem *e;
+	size_t i;
+
+	if (b->disk == journal_disk ())
+		return false;
+	for (e = list_begin (batch); e != list_end (batch); e = list_next (e)) {
+		struct sync_request *req = list_entry (e, struct sync_request, elem);
+
+		if (req->disk != b->disk)
+			continue;
+		for (i = 0; i < req->range_cnt; i++)
+			if (b->sector >= req->ranges[i].start
+					&& b->sector < req->ranges[i].end)
+				return true;
+	}
+	return false;
+}
+
+/* Makes the changes asked for by every sync_request in BATCH
+   durable, with one commit and one round of writes between them. */
+static void
+sync_batch (struct list *batch) {
+	struct list_elem *e;
+
+	for (e = list_begin (batch); e != list_end (batch); e = list_next (e))
+		if (list_entry (e, struct sync_request, elem)->disk == NULL) {
+			sync_all ();
+			return;
+		}
+	commit ();
+	flush_blocks (requested, batch);
+}
+
+/* Queues REQ and waits until it is done.  A flush that is already
+   running when the caller arrives may have missed the caller's
+   changes, so the caller needs the one after it; whoever finds no
+   flush running starts the next one on behalf of every request
+   queued by then. */
+static void
+sync_wait (struct sync_request *req) {
+	struct list batch;
+
+	req->done = false;
+	lock_acquire (&sync_lock);
+	list_push_back (&sync_queue, &req->elem);
+	while (!req->done) {
+		if (syncing) {
+			cond_wait (&sync_done, &sync_lock);
+			continue;
+		}
+		syncing = true;
+		list_init (&batch);
+		while (!list_empty (&sync_queue))
+			list_push_back (&batch, list_pop_front (&sync_queue));
+		lock_release (&sync_lock);
+
+		sync_batch (&batch);
+
+		lock_acquire (&sync_lock);
+		while (!list_empty (&batch))
+			list_entry (list_pop_front (&batch), struct sync_request,
+					elem)->done = true;
+		syncing = false;
+		cond_broadcast (&sync_done, &sync_lock);
+	}
+	lock_release (&sync_lock);
+}
+
+/* Makes every change made to a block so far durable, as sync_all()
+   does, sharing the work with concurrent callers. */
+void
+buffer_cache_sync (void) {
+	struct sync_request req = { .disk = NULL };
+
+	sync_wait (&req);
+}
+
+/* Makes the changes made so far to the CNT sector RANGES of disk D
+   durable, sharing the work with concurrent callers.  On the
+   journaled disk that takes a commit, which covers every change made
+   so far; on other disks only the cached sectors in RANGES are
+   written back. */
+void
+buffer_cache_sync_ranges (struct disk *d, const struct sector_range *ranges,
+		size_t cnt) {
+	struct sync_request req = { .disk = d, .ranges = ranges, .range_cnt = cnt };
+
+	ASSERT (d != NULL);
+	sync_wait (&req);
+}
+
+/* Background thread that periodically makes changes durable with
+   sync_all(). */
+static void
+flusher (void *aux UNUSED) {
+	for (;;) {
+		timer_sleep (FLUSH_INTERVAL);
+		sync_all ();
+	}
+}
+
+/* Hashes a block by disk and sector. */
+static uint64_t
+block_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct cache_block *b = hash_entry (e, struct cache_block, elem);
+	uintptr_t key[2] = { (uintptr_t) b->disk, b->sector };
+
+	return hash_bytes (key, sizeof key);
+}
+
+/* Orders blocks by disk and sector. */
+static bool
+block_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct cache_block *a = hash_entry (a_, struct cache_block, elem);
+	const struct cache_block *b = hash_entry (b_, struct cache_block, elem);
+
+	if (a->disk != b->disk)
+		return a->disk < b->disk;
+	return a->sector < b->sector;
+}
@@ -1,7 +1,10 @@
 #include "filesys/directory.h"
+#include <dirent.h>
 #include <stdio.h>
 #include <string.h>
 #include <list.h>
+#include <round.h>
+#include "filesys/fat.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
 #include "threads/malloc.h"
@@ -18,16 +21,17 @@ struct dir_entry {
 	disk_sector_t inode_sector;         /* Sector number of header. */
 	char name[NAME_MAX + 1];            /* Null terminated file name. */
 	bool in_use;                        /* In use or free? */
+	uint8_t type;                       /* DT_REG, DT_DIR or DT_LNK. */
 };
 
 /* Creates a directory with space for ENTRY_CNT entries in the
- * given SECTOR.  Returns true if successful, false on failure. */
+ * given SECTOR of FS.  Returns true if successful, false on failure. */
 bool
-dir_create (disk_sector_t sector, size_t entry_cnt) {
+dir_create (struct fs *fs, disk_sector_t sector, size_t entry_cnt) {
 	// printf("(dir_create)\n");
-	bool created = inode_create (sector, entry_cnt * sizeof (struct dir_entry), true);
+	bool created = inode_create (fs, sector, entry_cnt * sizeof (struct dir_entry), true);
 	if (created) {
-		struct inode *opened = inode_open(sector);
+		struct inode *opened = inode_open(fs, sector);
 		create_directory_inode(opened);
 	}
 	return created; // return값이 이게 안 추가되어있어서.. 
@@ -53,10 +57,17 @@ dir_open (struct inode *inode) {
  * Return true if successful, false on failure. */
 struct dir *
 dir_open_root (void) {
+	return dir_open_fs_root (root_fs);
+}
+
+/* Opens the root directory of FS and returns a directory for it.
+ * Returns a null pointer on failure. */
+struct dir *
+dir_open_fs_root (struct fs *fs) {
 	#ifdef EFILESYS
-		return dir_open(inode_open(cluster_to_sector(ROOT_DIR_SECTOR)));
+		return dir_open(inode_open(fs, cluster_to_sector(fs, ROOT_DIR_CLUSTER)));
 	#else
-		return dir_open (inode_open (ROOT_DIR_SECTOR));
+		return dir_open (inode_open (fs, ROOT_DIR_SECTOR));
 	#endif
 }
 
@@ -111,26 +122,68 @@ lookup (const struct dir *dir, const char *name,
 /* Searches DIR for a file with the given NAME
  * and returns true if one exists, false otherwise.
  * On success, sets *INODE to an inode for the file, otherwise to
- * a null pointer.  The caller must close *INODE. */
+ * a null pointer.  The caller must close *INODE.
+ * A directory that has a file system mounted on it is replaced by
+ * the root of that file system, and ".." in such a root leads back
+ * to the directory's parent. */
 bool
 dir_lookup (const struct dir *dir, const char *name,
 		struct inode **inode) {
 	struct dir_entry e;
+	struct fs *fs;
 
 	ASSERT (dir != NULL);
 	ASSERT (name != NULL);
 
+	fs = inode_get_fs (dir->inode);
+#ifdef EFILESYS
+	if (fs->mount_point != NULL && !strcmp (name, "..")
+			&& inode_get_inumber (dir->inode)
+			   == cluster_to_sector (fs, ROOT_DIR_CLUSTER)) {
+		struct dir parent = { .inode = fs->mount_point, .pos = 0 };
+		return dir_lookup (&parent, name, inode);
+	}
+#endif
+
 	if (lookup (dir, name, &e, NULL))
-		*inode = inode_open (e.inode_sector);
+		*inode = inode_open (fs, e.inode_sector);
 	else
 		*inode = NULL;
 
+#ifdef EFILESYS
+	if (*inode != NULL && inode_get_mounted (*inode) != NULL) {
+		struct fs *mounted = inode_get_mounted (*inode);
+
+		inode_close (*inode);
+		*inode = inode_open (mounted,
+		                     cluster_to_sector (mounted, ROOT_DIR_CLUSTER));
+	}
+#endif
+
 	return *inode != NULL;
 }
 
+/* Returns the struct dirent type of the file whose inode is in
+ * SECTOR of FS. */
+static uint8_t
+entry_type (struct fs *fs, disk_sector_t sector) {
+	struct inode *inode = inode_open (fs, sector);
+	uint8_t type = DT_REG;
+
+	if (inode != NULL) {
+		if (check_symlink (inode))
+			type = DT_LNK;
+		else if (inode_is_directory (inode))
+			type = DT_DIR;
+		inode_close (inode);
+	}
+	return type;
+}
+
 /* Adds a file named NAME to DIR, which must not already contain a
  * file by that name.  The file's inode is in sector
- * INODE_SECTOR.
+ * INODE_SECTOR, and must already be of its final type, which the
+ * entry records for dir_getdents().
  * Returns true if successful, false on failure.
  * Fails if NAME is invalid (i.e. too long) or a disk or memory
  * error occurs. */
@@ -167,6 +220,7 @@ dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
 
 	/* Write slot. */
 	e.in_use = true;
+	e.type = entry_type (inode_get_fs (dir->inode), inode_sector);
 	strlcpy (e.name, name, sizeof e.name);
 	e.inode_sector = inode_sector;
 	success = inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
@@ -195,7 +249,7 @@ dir_remove (struct dir *dir, const char *name) {
 		goto done;
 
 	/* Open inode. */
-	inode = inode_open (e.inode_sector);
+	inode = inode_open (inode_get_fs (dir->inode), e.inode_sector);
 	if (inode == NULL)
 		goto done;
 
@@ -280,6 +334,52 @@ done:
 	return success;
 }
 
+/* Number of entries dir_getdents() reads from disk at a time. */
+#define GETDENTS_BATCH 16
+
+/* Packs as many entries of directory INODE as fit in the SIZE bytes
+ * at BUF, as struct dirents, starting at byte *POS of the directory,
+ * and advances *POS past them.  "." and ".." are left out.  Entries
+ * are read GETDENTS_BATCH at a time rather than one by one, and their
+ * types come from the entries, without opening their inodes.  Returns
+ * the number of bytes used, which is 0 at the end of the directory,
+ * or -1 if not even the next entry fits in SIZE bytes. */
+int
+dir_getdents (struct inode *inode, off_t *pos, void *buf, size_t size) {
+	struct dir_entry batch[GETDENTS_BATCH];
+	uint8_t *out = buf;
+	size_t used = 0;
+
+	for (;;) {
+		size_t cnt = inode_read_at (inode, batch, sizeof batch, *pos)
+		             / sizeof *batch;
+		size_t i;
+
+		if (cnt == 0)
+			break;
+		for (i = 0; i < cnt; i++) {
+			struct dir_entry *e = &batch[i];
+
+			if (e->in_use && strcmp (e->name, ".") && strcmp (e->name, "..")) {
+				size_t len = strlen (e->name);
+				size_t reclen = ROUND_UP (sizeof (struct dirent) + len + 1,
+				                          sizeof (uint32_t));
+				struct dirent *d = (struct dirent *) (out + used);
+
+				if (used + reclen > size)
+					return used > 0 ? (int) used : -1;
+				d->d_ino = e->inode_sector;
+				d->d_reclen = reclen;
+				d->d_type = e->type;
+				memcpy (d->d_name, e->name, len + 1);
+				used += reclen;
+			}
+			*pos += sizeof *e;
+		}
+	}
+	return used;
+}
+
 /* Reads the next directory entry in DIR and stores the name in
  * NAME.  Returns true if successful, false if the directory
  * contains no more entries. */
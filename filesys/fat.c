@@ -1,204 +1,316 @@
 #include "filesys/fat.h"
 #include "devices/disk.h"
+#include "filesys/buffer_cache.h"
 #include "filesys/filesys.h"
+#include "filesys/journal.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
 #include "threads/synch.h"
+#include "threads/vaddr.h"
+#include <round.h>
 #include <stdio.h>
 #include <string.h>
 
+/* Number of FAT entries in one sector. */
+#define FAT_ENTRIES_PER_SECTOR (DISK_SECTOR_SIZE / sizeof (cluster_t))
+
 /* Should be less than DISK_SECTOR_SIZE */
 struct fat_boot {
 	unsigned int magic;
-	unsigned int sectors_per_cluster; /* Fixed to 1 */
+	unsigned int sectors_per_cluster; /* 1 to MAX_SECTORS_PER_CLUSTER. */
 	unsigned int total_sectors;
 	unsigned int fat_start;
 	unsigned int fat_sectors; /* Size of FAT in sectors. */
 	unsigned int root_dir_cluster;
+	unsigned int journal_start;   /* First sector of the journal. */
+	unsigned int journal_sectors; /* Size of the journal, 0 if none. */
 };
 
 /* FAT FS */
 struct fat_fs {
 	struct fat_boot bs; //부팅 시 FAT 정보를 담는 구조체
-	unsigned int *fat;	//FAT
 	unsigned int fat_length;	//file system안에 들어가있는 섹터의 수
 	disk_sector_t data_start;	//비어있는 첫 섹터
 	cluster_t last_clst;	//file이 할당받은 cluster 중, 마지막 cluster
 	struct lock write_lock;	
 };
 
-static struct fat_fs *fat_fs;
+/* Cluster size, in sectors, for a newly formatted disk. */
+static unsigned int format_cluster_sectors = 1;
 
-void fat_boot_create (void);
-void fat_fs_init (void);
+void fat_boot_create (struct fs *fs);
+void fat_fs_init (struct fs *fs);
 
-void
-fat_init (void) {
-	fat_fs = calloc (1, sizeof (struct fat_fs));
-	if (fat_fs == NULL)
-		PANIC ("FAT init failed");
+static cluster_t fat_get_entry (struct fs *fs, cluster_t clst);
+static void fat_put_entry (struct fs *fs, cluster_t clst, cluster_t entry);
+static void fat_free_entry (struct fs *fs, cluster_t clst);
+
+/* Returns true if the boot sector read into FS describes a file
+   system that fits on FS's disk.  Any disk can be mounted from user
+   programs, so nothing in it is trusted before this check. */
+static bool
+boot_sector_valid (struct fs *fs) {
+	const struct fat_boot *bs = &fs->fat->bs;
+	uint64_t data_start, fat_length;
+
+	if (bs->magic != FAT_MAGIC
+			|| bs->sectors_per_cluster < 1
+			|| bs->sectors_per_cluster > MAX_SECTORS_PER_CLUSTER
+			|| bs->total_sectors > disk_size (fs->disk)
+			|| bs->fat_start < 1
+			|| bs->root_dir_cluster != ROOT_DIR_CLUSTER)
+		return false;
+	if (bs->journal_sectors > 0
+			&& bs->journal_start != bs->fat_start + bs->fat_sectors)
+		return false;
+
+	/* Every cluster, and the FAT sector with its entry, must be on
+	   the disk. */
+	data_start = (uint64_t) bs->fat_start + bs->fat_sectors
+	             + bs->journal_sectors;
+	if (data_start >= bs->total_sectors)
+		return false;
+	fat_length = (bs->total_sectors - data_start) / bs->sectors_per_cluster + 1;
+	return bs->fat_start + (fat_length - 1) / FAT_ENTRIES_PER_SECTOR
+	       < bs->total_sectors;
+}
+
+/* Reads the FAT boot sector of FS's disk.  Returns true if the disk
+   already holds a valid file system; otherwise sets up a new boot
+   sector, which fat_create() must then write out, and returns false.
+   Also returns false, leaving FS->FAT null, if memory runs out. */
+bool
+fat_init (struct fs *fs) {
+	unsigned int *bounce;
+	bool formatted;
+
+	fs->fat = calloc (1, sizeof (struct fat_fs));
+	bounce = malloc (DISK_SECTOR_SIZE);
+	if (fs->fat == NULL || bounce == NULL) {
+		free (fs->fat);
+		free (bounce);
+		fs->fat = NULL;
+		return false;
+	}
 
 	// Read boot sector from the disk
-	unsigned int *bounce = malloc (DISK_SECTOR_SIZE);
-	if (bounce == NULL)
-		PANIC ("FAT init failed");
-	disk_read (filesys_disk, FAT_BOOT_SECTOR, bounce);
-	memcpy (&fat_fs->bs, bounce, sizeof (fat_fs->bs));
+	disk_read (fs->disk, FAT_BOOT_SECTOR, bounce);
+	memcpy (&fs->fat->bs, bounce, sizeof (fs->fat->bs));
 	free (bounce);
 
 	// Extract FAT info
-	if (fat_fs->bs.magic != FAT_MAGIC)
-		fat_boot_create ();
-	fat_fs_init ();
+	formatted = boot_sector_valid (fs);
+	if (!formatted)
+		fat_boot_create (fs);
+	fat_fs_init (fs);
+
+	// Bring the metadata up to date before anything reads it.  Only
+	// the root file system has a journal.
+	if (fs == root_fs && fs->fat->bs.journal_sectors > 0)
+		journal_open (fs->disk, fs->fat->bs.journal_start,
+		              fs->fat->bs.journal_sectors);
+	return formatted;
 }
 
+/* Frees the FAT information that fat_init() set up for FS. */
 void
-fat_open (void) {
-	fat_fs->fat = calloc (fat_fs->fat_length, sizeof (cluster_t));
-	if (fat_fs->fat == NULL)
-		PANIC ("FAT load failed");
-
-	// Load FAT directly from the disk
-	uint8_t *buffer = (uint8_t *) fat_fs->fat;
-	off_t bytes_read = 0;
-	off_t bytes_left = sizeof (fat_fs->fat);
-	const off_t fat_size_in_bytes = fat_fs->fat_length * sizeof (cluster_t);
-	for (unsigned i = 0; i < fat_fs->bs.fat_sectors; i++) {
-		bytes_left = fat_size_in_bytes - bytes_read;
-		if (bytes_left >= DISK_SECTOR_SIZE) {
-			disk_read (filesys_disk, fat_fs->bs.fat_start + i,
-			           buffer + bytes_read);
-			bytes_read += DISK_SECTOR_SIZE;
-		} else {
-			uint8_t *bounce = malloc (DISK_SECTOR_SIZE);
-			if (bounce == NULL)
-				PANIC ("FAT load failed");
-			disk_read (filesys_disk, fat_fs->bs.fat_start + i, bounce);
-			memcpy (buffer + bytes_read, bounce, bytes_left);
-			bytes_read += bytes_left;
-			free (bounce);
-		}
-	}
+fat_done (struct fs *fs) {
+	free (fs->fat);
+	fs->fat = NULL;
+}
+
+/* Returns true if FS's disk has a metadata journal. */
+bool
+fat_has_journal (struct fs *fs) {
+	return fs->fat->bs.journal_sectors > 0;
+}
+
+/* Sets the cluster size used when the disk is next formatted to
+   SECTORS sectors.  Returns false if SECTORS is out of range. */
+bool
+fat_set_cluster_size (unsigned int sectors) {
+	if (sectors < 1 || sectors > MAX_SECTORS_PER_CLUSTER)
+		return false;
+	format_cluster_sectors = sectors;
+	return true;
+}
+
+/* Returns the number of sectors in a cluster of FS's disk. */
+unsigned int
+fat_sectors_per_cluster (struct fs *fs) {
+	return fs->fat->bs.sectors_per_cluster;
 }
 
+/* The FAT itself is not loaded: fat_get() and fat_put() bring its
+   sectors into the buffer cache as they are needed, so opening takes
+   constant time and memory whatever the size of the disk. */
 void
-fat_close (void) {
+fat_open (struct fs *fs UNUSED) {
+}
+
+void
+fat_close (struct fs *fs) {
 	// Write FAT boot sector
 	uint8_t *bounce = calloc (1, DISK_SECTOR_SIZE);
 	if (bounce == NULL)
 		PANIC ("FAT close failed");
-	memcpy (bounce, &fat_fs->bs, sizeof (fat_fs->bs));
-	disk_write (filesys_disk, FAT_BOOT_SECTOR, bounce);
+	memcpy (bounce, &fs->fat->bs, sizeof (fs->fat->bs));
+	disk_write (fs->disk, FAT_BOOT_SECTOR, bounce);
 	free (bounce);
 
-	// Write FAT directly to the disk
-	uint8_t *buffer = (uint8_t *) fat_fs->fat;
-	off_t bytes_wrote = 0;
-	off_t bytes_left = sizeof (fat_fs->fat);
-	const off_t fat_size_in_bytes = fat_fs->fat_length * sizeof (cluster_t);
-	for (unsigned i = 0; i < fat_fs->bs.fat_sectors; i++) {
-		bytes_left = fat_size_in_bytes - bytes_wrote;
-		if (bytes_left >= DISK_SECTOR_SIZE) {
-			disk_write (filesys_disk, fat_fs->bs.fat_start + i,
-			            buffer + bytes_wrote);
-			bytes_wrote += DISK_SECTOR_SIZE;
-		} else {
-			bounce = calloc (1, DISK_SECTOR_SIZE);
-			if (bounce == NULL)
-				PANIC ("FAT close failed");
-			memcpy (bounce, buffer + bytes_wrote, bytes_left);
-			disk_write (filesys_disk, fat_fs->bs.fat_start + i, bounce);
-			bytes_wrote += bytes_left;
-			free (bounce);
-		}
-	}
+	// Write back the FAT sectors that are still dirty
+	fat_flush (fs);
 }
 
 void
-fat_create (void) {
+fat_create (struct fs *fs) {
 	// Create FAT boot
-	fat_boot_create ();
-	fat_fs_init ();
+	fat_boot_create (fs);
+	fat_fs_init (fs);
+	if (fs->fat->bs.journal_sectors > 0)
+		journal_format (fs->disk, fs->fat->bs.journal_start,
+		                fs->fat->bs.journal_sectors);
+
+	// Create an empty FAT table on disk, in large writes
+	uint8_t *zeros = palloc_get_multiple (PAL_ZERO | PAL_ASSERT,
+	    DIV_ROUND_UP (DISK_MAX_SECTORS * DISK_SECTOR_SIZE, PGSIZE));
+	for (size_t i = 0, cnt; i < fs->fat->bs.fat_sectors; i += cnt) {
+		struct disk_request req;
 
-	// Create FAT table
-	fat_fs->fat = calloc (fat_fs->fat_length, sizeof (cluster_t));
-	if (fat_fs->fat == NULL)
-		PANIC ("FAT creation failed");
+		cnt = fs->fat->bs.fat_sectors - i;
+		if (cnt > DISK_MAX_SECTORS)
+			cnt = DISK_MAX_SECTORS;
+		disk_write_async (fs->disk, fs->fat->bs.fat_start + i, cnt, zeros,
+		                  &req, NULL, NULL);
+		disk_wait (&req);
+	}
+	palloc_free_multiple (zeros,
+	    DIV_ROUND_UP (DISK_MAX_SECTORS * DISK_SECTOR_SIZE, PGSIZE));
 
 	// Set up ROOT_DIR_CLST
-	fat_put (ROOT_DIR_CLUSTER, EOChain);
+	fat_put (fs, ROOT_DIR_CLUSTER, EOChain);
 
 	// Fill up ROOT_DIR_CLUSTER region with 0
-	uint8_t *buf = calloc (1, DISK_SECTOR_SIZE);
+	uint8_t *buf = calloc (SECTORS_PER_CLUSTER (fs), DISK_SECTOR_SIZE);
+	struct disk_request req;
 	if (buf == NULL)
 		PANIC ("FAT create failed due to OOM");
-	disk_write (filesys_disk, cluster_to_sector (ROOT_DIR_CLUSTER), buf);
+	disk_write_async (fs->disk, cluster_to_sector (fs, ROOT_DIR_CLUSTER),
+	                  SECTORS_PER_CLUSTER (fs), buf, &req, NULL, NULL);
+	disk_wait (&req);
 	free (buf);
 }
 
 void
-fat_boot_create (void) {
+fat_boot_create (struct fs *fs) {
+	unsigned int journal_sectors =
+	    fs == root_fs && disk_size (fs->disk) >= JOURNAL_MIN_DISK
+	    ? JOURNAL_SECTORS : 0;
 	unsigned int fat_sectors =
-	    (disk_size (filesys_disk) - 1)
-	    / (DISK_SECTOR_SIZE / sizeof (cluster_t) * SECTORS_PER_CLUSTER + 1) + 1;
-	fat_fs->bs = (struct fat_boot){
+	    (disk_size (fs->disk) - 1 - journal_sectors)
+	    / (DISK_SECTOR_SIZE / sizeof (cluster_t) * format_cluster_sectors + 1)
+	    + 1;
+	fs->fat->bs = (struct fat_boot){
 	    .magic = FAT_MAGIC,
-	    .sectors_per_cluster = SECTORS_PER_CLUSTER,
-	    .total_sectors = disk_size (filesys_disk),
+	    .sectors_per_cluster = format_cluster_sectors,
+	    .total_sectors = disk_size (fs->disk),
 	    .fat_start = 1,
 	    .fat_sectors = fat_sectors,
 	    .root_dir_cluster = ROOT_DIR_CLUSTER,
+	    .journal_start = 1 + fat_sectors,
+	    .journal_sectors = journal_sectors,
 	};
 }
 
 void
-fat_fs_init (void) {
+fat_fs_init (struct fs *fs) {
 	/* TODO: Your code goes here. */
 	//fat_fs의 fat_length랑 data_start 필드를 초기화시켜준다
 	//fat_length는 파일 시스템에 있는 총 cluster의 개수를 담고 있어야한다 (파일 시스템 자체가 FAT이다)
 	//cluster는 여러 sector들로 이루어져있다
-	struct fat_boot booting_info = fat_fs->bs;
-	fat_fs->fat_length = booting_info.total_sectors - booting_info.fat_sectors - 1 / SECTORS_PER_CLUSTER;
-	//data_start은 어떤 sector에서부터 파일을 저장할 수 있는지를 알려준다
+	struct fat_boot booting_info = fs->fat->bs;
 	//실제 데이터 부분들은 fat table의 entries 뒤에 오기 때문에 fat가 시작한 지점에서 fat의 총 크기를 더하면 data의 시작점을 구할 수 있다
-	fat_fs->data_start = booting_info.fat_start + booting_info.fat_sectors;
+	fs->fat->data_start = booting_info.fat_start + booting_info.fat_sectors
+	                     + booting_info.journal_sectors;
+	/* Cluster numbers start at 1, and only whole clusters count. */
+	fs->fat->fat_length = (booting_info.total_sectors - fs->fat->data_start)
+	                     / booting_info.sectors_per_cluster + 1;
 	//last_clst랑 write_lock은 다른 곳에서 init안되고 있으니까 여기서 해줘야한다
-	fat_fs->last_clst = booting_info.total_sectors + 1;
-	lock_init(&fat_fs->write_lock);
+	fs->fat->last_clst = booting_info.total_sectors + 1;
+	lock_init(&fs->fat->write_lock);
+}
+
+/*----------------------------------------------------------------------------*/
+/* FAT write-back                                                             */
+/*----------------------------------------------------------------------------*/
+
+/* Returns the disk sector holding CLST's FAT entry. */
+disk_sector_t
+fat_sector (struct fs *fs, cluster_t clst) {
+	return fs->fat->bs.fat_start + clst / FAT_ENTRIES_PER_SECTOR;
+}
+
+/* Writes back the dirty FAT sectors among sectors START (inclusive)
+   through END (exclusive) of the FAT. */
+static void
+flush_range (struct fs *fs, size_t start, size_t end) {
+	if (start < end)
+		buffer_cache_flush_range (fs->disk, fs->fat->bs.fat_start + start,
+		                          fs->fat->bs.fat_start + end);
+}
+
+/* Writes every dirty FAT sector back to disk. */
+void
+fat_flush (struct fs *fs) {
+	flush_range (fs, 0, fs->fat->bs.fat_sectors);
 }
 
 /*----------------------------------------------------------------------------*/
 /* FAT handling                                                               */
 /*----------------------------------------------------------------------------*/
 
-cluster_t
-get_free_cluster() {
-	cluster_t free_space = 0;
-	for (cluster_t entry = fat_fs->bs.root_dir_cluster + 1; entry < (cluster_t)fat_fs->fat_length; entry++) {
-		if (fat_get(entry) == 0) {
-			//fat가 값이 0이면 free하다는 뜻이니까 이 처음 위치를 받아서 이걸 clst의 값으로 해서 연결시킨다
-			free_space = entry;
-			break;
-		}
-	}
+static cluster_t
+get_free_cluster (struct fs *fs) {
+	cluster_t entry = fs->fat->bs.root_dir_cluster + 1;
 
-	return free_space;
+	/* Scan a whole FAT sector per pin, not one entry. */
+	while (entry < (cluster_t)fs->fat->fat_length) {
+		struct cache_block *b = buffer_cache_pin (fs->disk,
+		                                          fat_sector (fs, entry), true);
+		cluster_t *fat = buffer_cache_data (b);
+		cluster_t end = ROUND_DOWN (entry, FAT_ENTRIES_PER_SECTOR)
+		                + FAT_ENTRIES_PER_SECTOR;
+
+		if (end > fs->fat->fat_length)
+			end = fs->fat->fat_length;
+		for (; entry < end; entry++)
+			if (fat[entry % FAT_ENTRIES_PER_SECTOR] == 0) {
+				//fat가 값이 0이면 free하다는 뜻이니까 이 처음 위치를 받아서 이걸 clst의 값으로 해서 연결시킨다
+				buffer_cache_unpin (b);
+				return entry;
+			}
+		buffer_cache_unpin (b);
+	}
+	return 0;
 }
 
 /* Add a cluster to the chain.
  * If CLST is 0, start a new chain.
- * Returns 0 if fails to allocate a new cluster. */
+ * Returns 0 if fails to allocate a new cluster.
+ * The new cluster is not zeroed on disk but marked unwritten, so that
+ * it reads as zeros until it is first written. */
 cluster_t
-fat_create_chain (cluster_t clst) {
+fat_create_chain (struct fs *fs, cluster_t clst) {
 	/* TODO: Your code goes here. */
 	//int *fat = fat_fs->fat;
-	cluster_t free_space = get_free_cluster();
+	cluster_t free_space = get_free_cluster (fs);
 
 	if (clst == 0) {
 		//여기서 새로운 chain을 만드니까 지금 들어온 clst가 chain의 첫 클러스터가 된다
 		//새로운 Chain을 만들기 위해 free한 공간을 하나 찾아서 배정해줘야한다
 		//아직 이거만 있으니까 end of file일테니 EOChain으로 표시해준다
 		if (free_space != 0) {
-			fat_put(free_space, EOChain);
+			fat_put_entry (fs, free_space, EOChain | FAT_UNWRITTEN);
 		} else {
 			return 0;
 		}
@@ -206,78 +318,223 @@ fat_create_chain (cluster_t clst) {
 		//해당 clst에 새로운 cluster를 하나 추가해주는거기 때문에 
 		//할당할 수 있는 free cluster를 찾고 이 위치넘버를 현재 clst의 값으로 넣어서 연결해줘야한다
 		if (free_space != 0) {
-			fat_put(clst, free_space);
+			fat_put (fs, clst, free_space);
 		} else {
 			return 0;
 		}
 
 		//여기서도 이 새롭게 추가해줄 cluster가 결국에 이 chain의 마지막 부분이 되는거니까 EOChain으로 세팅해야한다
-		fat_put(free_space, EOChain);
+		fat_put_entry (fs, free_space, EOChain | FAT_UNWRITTEN);
 	}
-	char zero_buf[DISK_SECTOR_SIZE] = {0};
-	disk_write(filesys_disk, cluster_to_sector(free_space), zero_buf);
 
 	return free_space;
 }
 
+/* Returns the first of CNT consecutive free clusters among clusters
+ * FROM (inclusive) through TO (exclusive), or 0 if there are none.
+ * Scans a whole FAT sector per pin. */
+static cluster_t
+find_free_run (struct fs *fs, cluster_t from, cluster_t to, size_t cnt) {
+	cluster_t entry = from, run_start = 0;
+	size_t run_len = 0;
+
+	if (to > fs->fat->fat_length)
+		to = fs->fat->fat_length;
+	while (entry < to) {
+		struct cache_block *b = buffer_cache_pin (fs->disk,
+		                                          fat_sector (fs, entry), true);
+		cluster_t *fat = buffer_cache_data (b);
+		cluster_t end = ROUND_DOWN (entry, FAT_ENTRIES_PER_SECTOR)
+		                + FAT_ENTRIES_PER_SECTOR;
+
+		if (end > to)
+			end = to;
+		for (; entry < end; entry++) {
+			if (fat[entry % FAT_ENTRIES_PER_SECTOR] != 0) {
+				run_len = 0;
+				continue;
+			}
+			if (run_len++ == 0)
+				run_start = entry;
+			if (run_len == cnt) {
+				buffer_cache_unpin (b);
+				return run_start;
+			}
+		}
+		buffer_cache_unpin (b);
+	}
+	return 0;
+}
+
+/* Starts a new chain of CNT clusters and returns its first cluster,
+ * storing its last one in *TAIL.  The clusters are taken from one
+ * run of consecutive free clusters, starting at HINT if possible (so
+ * that a file that grows stays contiguous), else the first run that
+ * is long enough; only if there is none are they gathered one by
+ * one.  Returns 0, allocating nothing, if the disk is full.  Like
+ * fat_create_chain(), the new clusters are marked unwritten. */
+cluster_t
+fat_allocate_run (struct fs *fs, cluster_t hint, size_t cnt,
+                  cluster_t *tail) {
+	cluster_t first = fs->fat->bs.root_dir_cluster + 1;
+	cluster_t start = 0, clst;
+	size_t i;
+
+	ASSERT (cnt > 0);
+
+	if (hint >= first)
+		start = find_free_run (fs, hint, hint + cnt, cnt);
+	if (start == 0)
+		start = find_free_run (fs, first, fs->fat->fat_length, cnt);
+
+	if (start == 0) {
+		/* Fragmented: one cluster at a time. */
+		cluster_t head = 0;
+
+		clst = 0;
+		for (i = 0; i < cnt; i++) {
+			clst = fat_create_chain (fs, clst);
+			if (clst == 0) {
+				if (head != 0)
+					fat_remove_chain (fs, head, 0);
+				return 0;
+			}
+			if (head == 0)
+				head = clst;
+		}
+		*tail = clst;
+		return head;
+	}
+
+	/* Chain the run together, a FAT sector per pin. */
+	for (i = 0, clst = start; i < cnt; ) {
+		struct cache_block *b = buffer_cache_pin (fs->disk,
+		                                          fat_sector (fs, clst), true);
+		cluster_t *fat = buffer_cache_data (b);
+
+		do {
+			fat[clst % FAT_ENTRIES_PER_SECTOR] =
+			    (i + 1 < cnt ? clst + 1 : EOChain) | FAT_UNWRITTEN;
+			i++;
+			clst++;
+		} while (i < cnt && clst % FAT_ENTRIES_PER_SECTOR != 0);
+		buffer_cache_mark_dirty (b);
+		buffer_cache_unpin (b);
+	}
+	*tail = start + cnt - 1;
+	return start;
+}
+
 /* Remove the chain of clusters starting from CLST.
  * If PCLST is 0, assume CLST as the start of the chain. */
 void
-fat_remove_chain (cluster_t clst, cluster_t pclst) {
+fat_remove_chain (struct fs *fs, cluster_t clst, cluster_t pclst) {
 	/* TODO: Your code goes here. */
 	//clst에서 시작해서 이어지는 cluster들을 제거해야하니까 여기서 EOChain을 가진 cluster를 찾을때까지
 	//각 fat entry에 0으로 free하다고 값을 바꿔줘야한다
-	//cluster_t entry = fat_get(clst);	
-	while (fat_get(clst) != EOChain) {
-		cluster_t entry = fat_get(clst);
-		//cluster_t curr_val = fat_get(clst);
-		fat_put(entry, 0);
+	/* Free each cluster only after reading its successor, so that the
+	 * walk does not lose the rest of the chain. */
+	while (clst != 0 && clst != EOChain) {
+		cluster_t entry = fat_get (fs, clst);
+		fat_free_entry (fs, clst);
 		clst = entry;
 	}
 
-	if (pclst == 0) {
-		//그럼 clst가 beginning of chain이기 때문에 이거를 0으로 바꿔줘야한다
-		fat_put(clst, 0);
-	} else {
+	if (pclst != 0) {
 		//0이 아닌경우에는 우리가 제거한 chain of cluster의 바로 직전 entry를 가지고 있으니
 		//지금 제거한거랑 구분하기 위해서 이 pclst는 end of chain이라는걸 표시해줘야한다
-		fat_put(pclst, EOChain);
+		fat_put (fs, pclst, EOChain);
 	}
 }
 
-/* Update a value in the FAT table. */
+/* Update a value in the FAT table.
+ * CLST's unwritten mark is kept, unless VAL is 0 (freeing CLST). */
 void
-fat_put (cluster_t clst, cluster_t val) {
+fat_put (struct fs *fs, cluster_t clst, cluster_t val) {
 	/* TODO: Your code goes here. */
 	//clst가 포인트하고 있는 FAT entry에 val로 업데이트해준다
 	//결국 이 clst번째에 있는 FAT가 다른 cluster랑 연결되도록 point하는 index를 바꿔주는거다
-	int *fat = fat_fs->fat;
-	fat[clst] = val;
+	if (val != 0)
+		val |= fat_get_entry (fs, clst) & FAT_UNWRITTEN;
+	fat_put_entry (fs, clst, val);
 }
 
 /* Fetch a value in the FAT table. */
 cluster_t
-fat_get (cluster_t clst) {
+fat_get (struct fs *fs, cluster_t clst) {
 	/* TODO: Your code goes here. */
 	//clst가 어떤 cluster를 point하는지를 찾는거기 때문에 FAT에서 clst에 들어있는 값만 빼오면 된다
-	int *fat = fat_fs->fat;
-	return fat[clst];
+	return fat_get_entry (fs, clst) & ~FAT_UNWRITTEN;
+}
+
+/* Returns true if CLST was allocated but has never been written.
+ * Its contents on disk are garbage and must be read as zeros. */
+bool
+fat_is_unwritten (struct fs *fs, cluster_t clst) {
+	return (fat_get_entry (fs, clst) & FAT_UNWRITTEN) != 0;
+}
+
+/* Records that CLST now holds real data on disk. */
+void
+fat_set_written (struct fs *fs, cluster_t clst) {
+	cluster_t entry = fat_get_entry (fs, clst);
+
+	if (entry & FAT_UNWRITTEN)
+		fat_put_entry (fs, clst, entry & ~FAT_UNWRITTEN);
+}
+
+/* Returns CLST's raw FAT entry, including its unwritten mark. */
+static cluster_t
+fat_get_entry (struct fs *fs, cluster_t clst) {
+	struct cache_block *b = buffer_cache_pin (fs->disk, fat_sector (fs, clst),
+	                                          true);
+	cluster_t entry = ((cluster_t *) buffer_cache_data (b))
+	                  [clst % FAT_ENTRIES_PER_SECTOR];
+	buffer_cache_unpin (b);
+	return entry;
+}
+
+/* Sets CLST's raw FAT entry to ENTRY. */
+static void
+fat_put_entry (struct fs *fs, cluster_t clst, cluster_t entry) {
+	struct cache_block *b = buffer_cache_pin (fs->disk, fat_sector (fs, clst),
+	                                          true);
+	cluster_t *fat = buffer_cache_data (b);
+	fat[clst % FAT_ENTRIES_PER_SECTOR] = entry;
+	buffer_cache_mark_dirty (b);
+	buffer_cache_unpin (b);
+}
+
+/* Marks CLST free.  Whatever of its old contents is cached or
+ * journaled is thrown away in the same step, so that neither can
+ * reach the disk once the cluster is reused. */
+static void
+fat_free_entry (struct fs *fs, cluster_t clst) {
+	struct cache_block *b = buffer_cache_pin (fs->disk, fat_sector (fs, clst),
+	                                          true);
+	disk_sector_t first = cluster_to_sector (fs, clst);
+	cluster_t *fat = buffer_cache_data (b);
+
+	buffer_cache_discard (fs->disk, first, first + SECTORS_PER_CLUSTER (fs));
+	fat[clst % FAT_ENTRIES_PER_SECTOR] = 0;
+	buffer_cache_mark_dirty (b);
+	buffer_cache_unpin (b);
 }
 
 /* Covert a cluster # to a sector number. */
 disk_sector_t
-cluster_to_sector (cluster_t clst) {
+cluster_to_sector (struct fs *fs, cluster_t clst) {
 	/* TODO: Your code goes here. */
 	// printf("(cluster_to_sector) clst: %d, fat_fs->fat_length: %d\n", clst, fat_fs->fat_length);
 	// printf("(cluster_to_sector) if clst is 0?: %s\n", clst == 0? "true":"false");
-	ASSERT(clst > 0 && clst < fat_fs->fat_length);
-	return fat_fs->data_start + (clst - 1) * SECTORS_PER_CLUSTER;
+	ASSERT(clst > 0 && clst < fs->fat->fat_length);
+	return fs->fat->data_start + (clst - 1) * SECTORS_PER_CLUSTER (fs);
 }
 
 //inode.c에서 쓰이는 conversion 함수
 cluster_t
-sector_to_cluster (disk_sector_t sector) {
+sector_to_cluster (struct fs *fs, disk_sector_t sector) {
 	// printf("(sector_to_cluster) sector: %d, fat_fs->data_start: %d\n", sector, fat_fs->data_start);
-	disk_sector_t difference = sector - fat_fs->data_start;
-	return (cluster_t) difference + 1;
+	disk_sector_t difference = sector - fs->fat->data_start;
+	return (cluster_t) (difference / SECTORS_PER_CLUSTER (fs)) + 1;
 }
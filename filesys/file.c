@@ -143,6 +143,14 @@ file_length (struct file *file) {
 	return inode_length (file->inode);
 }
 
+/* Forces FILE's contents, and unless DATASYNC its inode, to disk.
+ * LOCK is as for inode_sync(). */
+void
+file_sync (struct file *file, bool datasync, struct lock *lock) {
+	ASSERT (file != NULL);
+	inode_sync (file->inode, datasync, lock);
+}
+
 /* Sets the current position in FILE to NEW_POS bytes from the
  * start of the file. */
 void
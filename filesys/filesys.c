@@ -8,30 +8,43 @@
 #include "filesys/directory.h"
 #include "devices/disk.h"
 #include "filesys/fat.h"
+#include "filesys/buffer_cache.h"
+#include "threads/malloc.h"
 #include "threads/thread.h"
 
 /* The disk that contains the file system. */
 struct disk *filesys_disk;
 
-static void do_format (void);
+/* The root file system, on FILESYS_DISK. */
+static struct fs root;
+struct fs *root_fs = &root;
+
+/* File systems mounted on directories, in mount order. */
+static struct list mounts;
+
+static void do_format (struct fs *);
 
 /* Initializes the file system module.
  * If FORMAT is true, reformats the file system. */
 void
 filesys_init (bool format) {
-	filesys_disk = disk_get (0, 1);
+	filesys_disk = disk_get_role (DISK_FILESYS);
 	if (filesys_disk == NULL)
-		PANIC ("hd0:1 (hdb) not present, file system initialization failed");
+		PANIC ("file system disk not present, file system initialization failed");
 
+	root.disk = filesys_disk;
+	list_init (&mounts);
 	inode_init ();
 
 #ifdef EFILESYS
-	fat_init ();
+	buffer_cache_init ();
+	if (!fat_init (root_fs) && root_fs->fat == NULL)
+		PANIC ("FAT init failed");
 
 	if (format)
-		do_format ();
+		do_format (root_fs);
 
-	fat_open ();
+	fat_open (root_fs);
 
 	// printf("(filesys_init)\n");
 	thread_current()->current_dir = dir_open_root(); // root 정보를 기본적으로 깔고 감
@@ -40,7 +53,7 @@ filesys_init (bool format) {
 	free_map_init ();
 
 	if (format)
-		do_format ();
+		do_format (root_fs);
 
 	free_map_open ();
 #endif
@@ -52,12 +65,30 @@ void
 filesys_done (void) {
 	/* Original FS */
 #ifdef EFILESYS
-	fat_close ();
+	while (!list_empty (&mounts)) {
+		struct fs *fs = list_entry (list_front (&mounts), struct fs, elem);
+
+		fat_close (fs);
+		list_remove (&fs->elem);
+	}
+	fat_close (root_fs);
+	buffer_cache_flush ();
 #else
 	free_map_close ();
 #endif
 }
 
+/* Writes every change made to the file system so far to disk.
+ * Regular file data is written to disk as soon as it is written, so
+ * only inodes, directories and the FAT, which sit in the buffer cache,
+ * are left, and this is a buffer cache sync. */
+void
+filesys_sync (void) {
+#ifdef EFILESYS
+	buffer_cache_sync ();
+#endif
+}
+
 /* Creates a file named NAME with the given INITIAL_SIZE.
  * Returns true if successful, false otherwise.
  * Fails if a file named NAME already exists,
@@ -93,7 +124,8 @@ filesys_create (const char *name, off_t initial_size) {
 
 	// printf("(filesys_create) 3 어디가 문제야?\n"); // parsing이 문제다!
 	// 여기서부터는 채정이가 쓴 것
-	cluster_t clst = fat_create_chain(0);
+	struct fs *fs = dir != NULL ? inode_get_fs (dir_get_inode (dir)) : root_fs;
+	cluster_t clst = fat_create_chain(fs, 0);
 	
 	// if (clst == 0) {
 	// 	fat_remove_chain(clst, 0);
@@ -105,8 +137,8 @@ filesys_create (const char *name, off_t initial_size) {
 	//create_file_inode(inode_open(inode_sector));
 	//printf("(filesys_create) dir != NULL: %d\n", dir != NULL);
 	
-	bool success = (dir != NULL && inode_create (cluster_to_sector(clst), initial_size, false)
-			&& dir_add (dir, final_name, cluster_to_sector(clst)));
+	bool success = (dir != NULL && inode_create (fs, cluster_to_sector(fs, clst), initial_size, false)
+			&& dir_add (dir, final_name, cluster_to_sector(fs, clst)));
 	
 	/*
 	// printf 확인용
@@ -126,7 +158,7 @@ filesys_create (const char *name, off_t initial_size) {
 	if (!success && clst != 0) {
 		// printf("(filesys_create) success: %d\n", success); // 얘가 0이다. 뭐가 문제였을까
 		// printf("(filesys_create) clst != 0: %d\n", clst != 0);
-		fat_remove_chain(clst, 0);
+		fat_remove_chain(fs, clst, 0);
 	}
 
 	free(copy_name);
@@ -139,7 +171,7 @@ filesys_create (const char *name, off_t initial_size) {
 	dir = dir_open_root ();
 	bool success = (dir != NULL
 			&& free_map_allocate (1, &inode_sector)
-			&& inode_create (inode_sector, initial_size, false)
+			&& inode_create (root_fs, inode_sector, initial_size, false)
 			&& dir_add (dir, name, inode_sector));
 	#endif
 	if (!success && inode_sector != 0)
@@ -343,27 +375,27 @@ filesys_remove (const char *name) {
 	#endif
 }
 
-/* Formats the file system. */
+/* Formats file system FS. */
 static void
-do_format (void) {
+do_format (struct fs *fs) {
 	printf ("Formatting file system...");
 
 #ifdef EFILESYS
 	/* Create FAT and save it to the disk. */
 	// printf("\n(do_format)\n"); // 여기서 dir_create를 해줘야 하는데 으악 이걸 안해줬나봄.
-	fat_create ();
+	fat_create (fs);
 
-	dir_create(cluster_to_sector(ROOT_DIR_CLUSTER), 16);
-	struct dir *dir = dir_open_root();
+	dir_create(fs, cluster_to_sector(fs, ROOT_DIR_CLUSTER), 16);
+	struct dir *dir = dir_open_fs_root(fs);
 	// printf("(do_format) dir_get_inode(dir): %d\n", inode_get_inumber(dir_get_inode(dir)));
 	dir_add(dir, ".", inode_get_inumber(dir_get_inode(dir)));
 	dir_add(dir, "..", inode_get_inumber(dir_get_inode(dir)));
 	dir_close(dir);
 
-	fat_close ();
+	fat_close (fs);
 #else
 	free_map_create ();
-	if (!dir_create (ROOT_DIR_SECTOR, 16))
+	if (!dir_create (fs, ROOT_DIR_SECTOR, 16))
 		PANIC ("root directory creation failed");
 	free_map_close ();
 #endif
@@ -371,6 +403,199 @@ do_format (void) {
 	printf ("done.\n");
 }
 
+/* Opens the inode that PATH names, following symbolic links in its
+ * directories but not at its end.  Returns a null pointer if there is
+ * none.  The caller must close the inode. */
+struct inode *
+filesys_lookup (const char *path) {
+	struct inode *inode = NULL;
+	struct dir *dir;
+
+#ifdef EFILESYS
+	char *copy, *final_name;
+
+	if (path[strspn (path, "/")] == '\0') {
+		/* Only slashes: the root directory, which parsing() cannot
+		 * name. */
+		if (path[0] != '/')
+			return NULL;
+		dir = dir_open_root ();
+		inode = inode_reopen (dir_get_inode (dir));
+		dir_close (dir);
+		return inode;
+	}
+
+	copy = malloc (strlen (path) + 1);
+	final_name = malloc (strlen (path) + 1);
+	if (copy != NULL && final_name != NULL) {
+		strlcpy (copy, path, strlen (path) + 1);
+		dir = path[0] == '/' ? dir_open_root ()
+		      : dir_reopen (thread_current ()->current_dir);
+		dir = parsing (dir, copy, final_name);
+		if (dir != NULL)
+			dir_lookup (dir, final_name, &inode);
+		dir_close (dir);
+	}
+	free (copy);
+	free (final_name);
+#else
+	dir = dir_open_root ();
+	if (dir != NULL)
+		dir_lookup (dir, path, &inode);
+	dir_close (dir);
+#endif
+	return inode;
+}
+
+#ifdef EFILESYS
+
+/* Returns true if DISK holds the root file system or a mounted one. */
+static bool
+fs_in_use (struct disk *disk) {
+	struct list_elem *e;
+
+	if (disk == root_fs->disk)
+		return true;
+	for (e = list_begin (&mounts); e != list_end (&mounts); e = list_next (e))
+		if (list_entry (e, struct fs, elem)->disk == disk)
+			return true;
+	return false;
+}
+#endif
+
+/* Formats DISK with an empty file system, which can then be mounted.
+ * Returns false if DISK is in use, reserved for the kernel, or memory
+ * runs out. */
+#ifdef EFILESYS
+bool
+filesys_format (struct disk *disk) {
+	struct fs *fs;
+
+	if (fs_in_use (disk) || disk_is_reserved (disk))
+		return false;
+	fs = calloc (1, sizeof *fs);
+	if (fs == NULL)
+		return false;
+	fs->disk = disk;
+	if (!fat_init (fs) && fs->fat == NULL) {
+		free (fs);
+		return false;
+	}
+	do_format (fs);
+
+	/* Nothing of DISK may stay cached once it is not mounted. */
+	buffer_cache_flush_range (disk, 0, disk_size (disk));
+	buffer_cache_discard (disk, 0, disk_size (disk));
+	fat_done (fs);
+	free (fs);
+	return true;
+}
+#else
+bool
+filesys_format (struct disk *disk UNUSED) {
+	return false;
+}
+#endif
+
+/* Mounts the file system on disk CHAN_NO:DEV_NO on the directory
+ * PATH, which then stands for the file system's root directory.
+ * Returns 0 if successful, -1 if PATH is not a directory, or the disk
+ * does not exist, is reserved for the kernel, is already in use,
+ * holds no file system, or has a journal that only the root file
+ * system could replay.  A disk is never formatted as a side effect;
+ * filesys_format() does that. */
+#ifdef EFILESYS
+int
+filesys_mount (const char *path, int chan_no, int dev_no) {
+	struct inode *inode;
+	struct disk *disk;
+	struct fs *fs;
+
+	if (chan_no < 0 || (dev_no != 0 && dev_no != 1))
+		return -1;
+	disk = disk_get (chan_no, dev_no);
+	if (disk == NULL || fs_in_use (disk) || disk_is_reserved (disk))
+		return -1;
+
+	/* Mounting on the root of a file system would hide it for good. */
+	inode = filesys_lookup (path);
+	if (inode == NULL || !inode_is_directory (inode)
+			|| inode_get_mounted (inode) != NULL
+			|| inode_get_inumber (inode)
+			   == cluster_to_sector (inode_get_fs (inode), ROOT_DIR_CLUSTER)) {
+		inode_close (inode);
+		return -1;
+	}
+
+	fs = calloc (1, sizeof *fs);
+	if (fs == NULL) {
+		inode_close (inode);
+		return -1;
+	}
+	fs->disk = disk;
+	fs->mount_point = inode;
+	if (!fat_init (fs) || fat_has_journal (fs)) {
+		fat_done (fs);
+		free (fs);
+		inode_close (inode);
+		return -1;
+	}
+	fat_open (fs);
+
+	/* The mount keeps INODE open, and with it the record of FS. */
+	inode_set_mounted (inode, fs);
+	list_push_back (&mounts, &fs->elem);
+	return 0;
+}
+#else
+int
+filesys_mount (const char *path UNUSED, int chan_no UNUSED,
+		int dev_no UNUSED) {
+	return -1;
+}
+#endif
+
+/* Unmounts the file system whose root directory PATH names.  Returns
+ * 0 if successful, -1 if PATH does not name the root of a mounted file
+ * system or any of its files are still open. */
+#ifdef EFILESYS
+int
+filesys_umount (const char *path) {
+	struct inode *inode = filesys_lookup (path);
+	struct fs *fs;
+
+	if (inode == NULL)
+		return -1;
+	fs = inode_get_fs (inode);
+	if (fs == root_fs || inode_get_inumber (inode)
+			!= cluster_to_sector (fs, ROOT_DIR_CLUSTER)) {
+		inode_close (inode);
+		return -1;
+	}
+	inode_close (inode);
+	if (inode_fs_busy (fs))
+		return -1;
+
+	/* Write everything back, then forget the disk's cached blocks, so
+	 * that nothing stale is found if it is mounted again. */
+	fat_close (fs);
+	buffer_cache_flush_range (fs->disk, 0, disk_size (fs->disk));
+	buffer_cache_discard (fs->disk, 0, disk_size (fs->disk));
+
+	list_remove (&fs->elem);
+	inode_set_mounted (fs->mount_point, NULL);
+	inode_close (fs->mount_point);
+	fat_done (fs);
+	free (fs);
+	return 0;
+}
+#else
+int
+filesys_umount (const char *path UNUSED) {
+	return -1;
+}
+#endif
+
 // syscall.c의 mkdir이랑 symlink에서 썼던 parsing하는게 계속 쓰이네 여기서도
 struct dir *parsing(struct dir *dir, char *path, char *final_name) {
 	if (path == NULL || strlen(path) == 0) {
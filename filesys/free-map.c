@@ -48,7 +48,7 @@ free_map_release (disk_sector_t sector, size_t cnt) {
 /* Opens the free map file and reads it from disk. */
 void
 free_map_open (void) {
-	free_map_file = file_open (inode_open (FREE_MAP_SECTOR));
+	free_map_file = file_open (inode_open (root_fs, FREE_MAP_SECTOR));
 	if (free_map_file == NULL)
 		PANIC ("can't open free map");
 	if (!bitmap_read (free_map, free_map_file))
@@ -66,11 +66,11 @@ free_map_close (void) {
 void
 free_map_create (void) {
 	/* Create inode. */
-	if (!inode_create (FREE_MAP_SECTOR, bitmap_file_size (free_map), false))
+	if (!inode_create (root_fs, FREE_MAP_SECTOR, bitmap_file_size (free_map), false))
 		PANIC ("free map creation failed");
 
 	/* Write bitmap to file. */
-	free_map_file = file_open (inode_open (FREE_MAP_SECTOR));
+	free_map_file = file_open (inode_open (root_fs, FREE_MAP_SECTOR));
 	if (free_map_file == NULL)
 		PANIC ("can't open free map");
 	if (!bitmap_write (free_map, free_map_file))
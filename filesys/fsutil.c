@@ -62,6 +62,20 @@ fsutil_rm (char **argv) {
 		PANIC ("%s: delete failed\n", file_name);
 }
 
+/* Formats disk ARGV[1], written as "hdC:D", with an empty file
+ * system, so that it can be mounted. */
+void
+fsutil_mkfs (char **argv) {
+	const char *name = argv[1];
+	struct disk *disk = disk_get_by_name (name);
+
+	printf ("Formatting '%s'...\n", name);
+	if (disk == NULL)
+		PANIC ("%s: no such disk", name);
+	if (!filesys_format (disk))
+		PANIC ("%s: format failed", name);
+}
+
 /* Copies from the "scratch" disk, hdc or hd1:0 to file ARGV[1]
  * in the file system.
  *
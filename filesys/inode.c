@@ -2,15 +2,41 @@
 #include <list.h>
 #include <debug.h>
 #include <round.h>
+#include <stat.h>
 #include <string.h>
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "filesys/buffer_cache.h"
 #include "filesys/fat.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
 
+/* Bytes in a cluster. */
+#define CLUSTER_BYTES(FS) (DISK_SECTOR_SIZE * SECTORS_PER_CLUSTER (FS))
+
+/* Number of holes an inode can record. */
+#define INODE_HOLE_CNT 62
+
+/* Largest file whose data is kept inside its inode. */
+#define INODE_INLINE_MAX 496
+
+/* byte_to_sector() result for a byte that lies in a hole. */
+#define SECTOR_HOLE ((disk_sector_t) -2)
+
+/* A hole: LENGTH clusters of a file, starting at cluster START
+ * within the file, that have no clusters on disk and read as zeros.
+ * The file's cluster chain holds only the clusters outside holes,
+ * in file order. */
+struct inode_hole {
+	uint32_t start;                     /* First cluster within file. */
+	uint32_t length;                    /* Number of clusters. */
+};
+
 /* On-disk inode.
  * Must be exactly DISK_SECTOR_SIZE bytes long. */
 struct inode_disk {
@@ -20,11 +46,16 @@ struct inode_disk {
 	// uint32_t unused[125];               /* Not used. */
 	bool directory;			//이 Inode가 파일인지 디렉토리인지
 	bool symlink; 			// 이 inode가 link file인지
+	uint8_t hole_cnt;                   /* Number of HOLES in use. */
+	bool inlined;                       /* Data is in INLINE_DATA? */
 	// disk_sector_t & off_t & unsigned 모두 4바이트
-	// unused는 그냥 안쓰이니까 제외 (처음부터 DISK_SECTOR_SIZE 맞춰주려고 넣은 듯)
 	// bool은 1바이트 => DISK_SECTOR_SIZE = 512바이트이므로
-	// 512-4-4-4-1-1 = 498
-	char symlink_path[498];
+	// 512-4-4-4-1-1-1-1 = 496
+	union {
+		char symlink_path[496];         /* Target, if SYMLINK. */
+		struct inode_hole holes[INODE_HOLE_CNT]; /* Sorted, disjoint. */
+		uint8_t inline_data[INODE_INLINE_MAX]; /* Data, if INLINED. */
+	};
 };
 
 /* Returns the number of sectors to allocate for an inode SIZE
@@ -38,15 +69,41 @@ bytes_to_sectors (off_t size) {
 //컴퓨터가 인식하는 파일 구조체 느낌이라고 생각하면 된다
 struct inode {
 	struct list_elem elem;              /* Element in inode list. */
+	struct fs *fs;                      /* File system it belongs to. */
 	disk_sector_t sector;               /* Sector number of disk location. */
 	int open_cnt;                       /* Number of openers. */
 	bool removed;                       /* True if deleted, false otherwise. */
 	int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
 	struct inode_disk data;             /* Inode content. */
+	struct fs *mounted;                 /* File system mounted here, if any. */
 };
 
+/* Looks up cluster IDX of the file whose inode is DATA.  Stores in
+ * *CHAIN_POS the number of clusters in the file's chain that come
+ * before it.  Returns the index of the hole that contains IDX, or -1
+ * if it is not in a hole. */
+static int
+find_hole (const struct inode_disk *data, uint32_t idx, uint32_t *chain_pos) {
+	uint32_t skipped = 0;
+	int i;
+
+	for (i = 0; i < data->hole_cnt; i++) {
+		const struct inode_hole *h = &data->holes[i];
+
+		if (idx < h->start)
+			break;
+		if (idx < h->start + h->length) {
+			*chain_pos = h->start - skipped;
+			return i;
+		}
+		skipped += h->length;
+	}
+	*chain_pos = idx - skipped;
+	return -1;
+}
+
 /* Returns the disk sector that contains byte offset POS within
- * INODE.
+ * INODE, or SECTOR_HOLE if POS lies in a hole.
  * Returns -1 if INODE does not contain data for a byte at offset
  * POS. */
 static disk_sector_t
@@ -67,12 +124,18 @@ byte_to_sector (const struct inode *inode, off_t pos) {
 	// 지금 symlink인 경우에 inode->data.start가 0이 나오는 것 같다!!
 
 	if (pos < inode->data.length) {
+		uint32_t chain_pos;
+		if (find_hole (&inode->data, pos / CLUSTER_BYTES (inode->fs), &chain_pos) >= 0)
+			return SECTOR_HOLE;
+		if (inode->data.start == 0)
+			return -1;
+
 		//현재 inode가 들어있는 섹터를 가져온다
-		cluster_t pos_clst = sector_to_cluster(inode->data.start);
+		cluster_t pos_clst = sector_to_cluster(inode->fs, inode->data.start);
 		//cluster_t clst;
 		//이제 해당 offset pos을 가진 위치로 가서 거기에 담겨있는 value를 찾고 섹터값으로 변환해줘야한다 
-		for (int i = 0; i < (pos / DISK_SECTOR_SIZE); i++) {
-			pos_clst = fat_get(pos_clst);
+		for (uint32_t i = 0; i < chain_pos; i++) {
+			pos_clst = fat_get(inode->fs, pos_clst);
 			if (pos_clst == 0) {
 				return -1;
 			}
@@ -82,13 +145,359 @@ byte_to_sector (const struct inode *inode, off_t pos) {
 			return -1;
 		}
 		//printf("cluster num: %d", pos_clst);
-		return cluster_to_sector(pos_clst);
+		return cluster_to_sector(inode->fs, pos_clst)
+		       + pos / DISK_SECTOR_SIZE % SECTORS_PER_CLUSTER (inode->fs);
 		//return cluster_to_sector(clst);
 	} else {
 		return -1;
 	}
 }
 
+#ifdef EFILESYS
+/* Returns true if SECTOR of FS belongs to a cluster that has never been
+ * written.  Such a sector reads as zeros, whatever is on disk. */
+static bool
+sector_unwritten (struct fs *fs, disk_sector_t sector) {
+	return fat_is_unwritten (fs, sector_to_cluster (fs, sector));
+}
+
+/* Called after the first write to the CNT sectors starting at
+ * SECTOR, which sector_unwritten() said were unwritten.  Zeros the
+ * rest of their cluster, if any, and then marks the cluster
+ * written.  The sectors before and after the written ones are each
+ * zeroed with one multi-sector write, and both are in flight at
+ * once. */
+static void
+sector_written (struct fs *fs, disk_sector_t sector, size_t cnt) {
+	static char zeros[MAX_SECTORS_PER_CLUSTER * DISK_SECTOR_SIZE];
+	cluster_t clst = sector_to_cluster (fs, sector);
+	disk_sector_t first = cluster_to_sector (fs, clst);
+	disk_sector_t end = first + SECTORS_PER_CLUSTER (fs);
+	struct disk_request before, after;
+
+	ASSERT (MAX_SECTORS_PER_CLUSTER <= DISK_MAX_SECTORS);
+
+	if (sector > first)
+		disk_write_async (fs->disk, first, sector - first, zeros,
+				&before, NULL, NULL);
+	if (sector + cnt < end)
+		disk_write_async (fs->disk, sector + cnt, end - (sector + cnt), zeros,
+				&after, NULL, NULL);
+	if (sector > first)
+		disk_wait (&before);
+	if (sector + cnt < end)
+		disk_wait (&after);
+	fat_set_written (fs, clst);
+}
+#endif
+
+/* Returns how many whole sectors, starting at the sector that holds
+ * byte OFFSET (which must start a sector), can be moved in one
+ * request without leaving OFFSET's cluster or going past LIMIT
+ * bytes.  Returns 0 if not even one sector fits. */
+static size_t
+run_sectors (struct fs *fs, off_t offset, off_t limit) {
+	size_t cluster_left = SECTORS_PER_CLUSTER (fs)
+	                      - offset / DISK_SECTOR_SIZE % SECTORS_PER_CLUSTER (fs);
+	size_t cnt = limit / DISK_SECTOR_SIZE;
+
+	return cnt < cluster_left ? cnt : cluster_left;
+}
+
+/* Reads the on-disk inode at SECTOR of FS into DATA. */
+static void
+read_disk_inode (struct fs *fs, disk_sector_t sector, struct inode_disk *data) {
+#ifdef EFILESYS
+	buffer_cache_read (fs->disk, sector, data, 0, DISK_SECTOR_SIZE);
+#else
+	disk_read (fs->disk, sector, data);
+#endif
+}
+
+/* Writes DATA as the on-disk inode at SECTOR of FS.  Like directory
+ * contents, it is metadata: it only goes to the buffer cache, and
+ * from there through the journal. */
+static void
+write_disk_inode (struct fs *fs, disk_sector_t sector,
+                  const struct inode_disk *data) {
+#ifdef EFILESYS
+	buffer_cache_write (fs->disk, sector, data, 0, DISK_SECTOR_SIZE, false);
+#else
+	disk_write (fs->disk, sector, data);
+#endif
+}
+
+/* Sectors of a user buffer staged through one kernel page. */
+#define STAGE_SECTORS (PGSIZE / DISK_SECTOR_SIZE)
+
+/* Reads or writes, according to WRITE, the CNT sectors starting at
+ * SECTOR of FS into or from kernel memory at BUFFER, as a single disk
+ * request. */
+static void
+request (struct fs *fs, disk_sector_t sector, size_t cnt, void *buffer,
+         bool write) {
+	struct disk_request req;
+
+	if (write)
+		disk_write_async (fs->disk, sector, cnt, buffer, &req, NULL, NULL);
+	else
+		disk_read_async (fs->disk, sector, cnt, buffer, &req, NULL, NULL);
+	disk_wait (&req);
+}
+
+/* Reads or writes, according to WRITE, the CNT sectors starting at
+ * SECTOR of FS.  A kernel BUFFER goes to the disk as a single
+ * request.  A user BUFFER, from read() or write(), is copied through
+ * a kernel page instead, STAGE_SECTORS at a time, since the disk
+ * driver cannot reach it.  Returns false if out of memory. */
+static bool
+transfer (struct fs *fs, disk_sector_t sector, size_t cnt, void *buffer,
+          bool write) {
+	uint8_t *p = buffer;
+	uint8_t *stage;
+
+	if (is_kernel_vaddr (buffer)) {
+		request (fs, sector, cnt, buffer, write);
+		return true;
+	}
+
+	stage = palloc_get_page (0);
+	if (stage == NULL)
+		return false;
+	while (cnt > 0) {
+		size_t n = cnt < STAGE_SECTORS ? cnt : STAGE_SECTORS;
+		size_t bytes = n * DISK_SECTOR_SIZE;
+
+		if (write)
+			memcpy (stage, p, bytes);
+		request (fs, sector, n, stage, write);
+		if (!write)
+			memcpy (p, stage, bytes);
+		p += bytes;
+		sector += n;
+		cnt -= n;
+	}
+	palloc_free_page (stage);
+	return true;
+}
+
+/* Returns the cluster at position POS in the chain of the file
+ * whose inode is DATA, on FS, or 0 if the chain is shorter. */
+static cluster_t
+chain_nth (struct fs *fs, const struct inode_disk *data, uint32_t pos) {
+	cluster_t clst;
+
+	if (data->start == 0)
+		return 0;
+	clst = sector_to_cluster (fs, data->start);
+	while (pos-- > 0) {
+		clst = fat_get (fs, clst);
+		if (clst == 0 || clst == EOChain)
+			return 0;
+	}
+	return clst;
+}
+
+/* Returns the last cluster in DATA's chain on FS, or 0 if it is
+ * empty, and stores the number of clusters in the chain in *CNT. */
+static cluster_t
+chain_last (struct fs *fs, const struct inode_disk *data, uint32_t *cnt) {
+	cluster_t clst, next;
+
+	*cnt = 0;
+	if (data->start == 0)
+		return 0;
+	clst = sector_to_cluster (fs, data->start);
+	*cnt = 1;
+	while ((next = fat_get (fs, clst)) != EOChain && next != 0) {
+		clst = next;
+		++*cnt;
+	}
+	return clst;
+}
+
+/* Returns the number of clusters of the file whose inode is DATA,
+ * from its start, that its chain of CHAIN_CNT clusters and its holes
+ * account for.  This is more than its length covers only if
+ * inode_allocate() reserved clusters past the end of file. */
+static uint32_t
+mapped_clusters (const struct inode_disk *data, uint32_t chain_cnt) {
+	uint32_t cnt = chain_cnt;
+	int i;
+
+	for (i = 0; i < data->hole_cnt; i++)
+		cnt += data->holes[i].length;
+	return cnt;
+}
+
+/* Allocates a run of CNT unwritten clusters on FS, chained together,
+ * and stores its first and last clusters in *HEAD and *TAIL.  The run
+ * is contiguous on disk if FS has room for that, preferably starting
+ * at cluster HINT.  Returns false, allocating nothing, if the disk is
+ * full. */
+static bool
+allocate_run (struct fs *fs, cluster_t hint, uint32_t cnt, cluster_t *head,
+              cluster_t *tail) {
+	*head = fat_allocate_run (fs, hint, cnt, tail);
+	return *head != 0;
+}
+
+/* Gives cluster IDX of INODE, which lies in a hole, a cluster of its
+ * own and returns the cluster's first sector, or -1 if the disk is
+ * full.  The new cluster is unwritten, so it still reads as zeros. */
+static disk_sector_t
+fill_hole (struct inode *inode, uint32_t idx) {
+	struct inode_disk *data = &inode->data;
+	struct fs *fs = inode->fs;
+	struct inode_hole *hole;
+	uint32_t chain_pos, hole_end, cnt = 1;
+	cluster_t head, tail, prev;
+	int h;
+
+	h = find_hole (data, idx, &chain_pos);
+	ASSERT (h >= 0);
+	hole = &data->holes[h];
+	hole_end = hole->start + hole->length;
+
+	/* Splitting the hole needs another slot.  If there is none,
+	 * allocate the rest of the hole as well. */
+	if (idx > hole->start && idx + 1 < hole_end
+			&& data->hole_cnt == INODE_HOLE_CNT)
+		cnt = hole_end - idx;
+	prev = chain_pos > 0 ? chain_nth (fs, data, chain_pos - 1) : 0;
+	if (!allocate_run (fs, prev + 1, cnt, &head, &tail))
+		return -1;
+
+	/* Splice the run into the chain where IDX belongs. */
+	if (prev == 0) {
+		fat_put (fs, tail, data->start != 0
+				? sector_to_cluster (fs, data->start) : EOChain);
+		data->start = cluster_to_sector (fs, head);
+	} else {
+		fat_put (fs, tail, fat_get (fs, prev));
+		fat_put (fs, prev, head);
+	}
+
+	/* Shrink, split or drop the hole. */
+	if (idx == hole->start && idx + cnt == hole_end) {
+		memmove (hole, hole + 1, (data->hole_cnt - h - 1) * sizeof *hole);
+		data->hole_cnt--;
+	} else if (idx == hole->start) {
+		hole->start++;
+		hole->length--;
+	} else if (idx + cnt == hole_end) {
+		hole->length = idx - hole->start;
+	} else {
+		memmove (hole + 2, hole + 1, (data->hole_cnt - h - 1) * sizeof *hole);
+		hole[1].start = idx + 1;
+		hole[1].length = hole_end - idx - 1;
+		hole->length = idx - hole->start;
+		data->hole_cnt++;
+	}
+
+	write_disk_inode (fs, inode->sector, data);
+	return cluster_to_sector (fs, head);
+}
+
+/* Moves the data of INODE, which is kept inline, out to clusters,
+ * because it is about to grow too large for the inode.  Returns
+ * false, leaving INODE unchanged, if the disk is full. */
+static bool
+migrate_inline (struct inode *inode) {
+	struct inode_disk *data = &inode->data;
+	off_t length = data->length;
+	uint8_t *copy = NULL;
+
+	ASSERT (data->inlined);
+
+	if (length > 0) {
+		copy = malloc (length);
+		if (copy == NULL)
+			return false;
+		memcpy (copy, data->inline_data, length);
+	}
+
+	/* Turn INODE into an empty regular file and write the data back
+	 * through the normal path. */
+	memset (data->inline_data, 0, sizeof data->inline_data);
+	data->inlined = false;
+	data->length = 0;
+	data->start = 0;
+	if (length > 0 && inode_write_at (inode, copy, length, 0) != length) {
+		if (data->start != 0)
+			fat_remove_chain (inode->fs,
+			                  sector_to_cluster (inode->fs, data->start), 0);
+		memset (data->inline_data, 0, sizeof data->inline_data);
+		memcpy (data->inline_data, copy, length);
+		data->inlined = true;
+		data->length = length;
+		data->start = 0;
+		data->hole_cnt = 0;
+		free (copy);
+		return false;
+	}
+	free (copy);
+	return true;
+}
+
+/* Grows INODE to NEW_LENGTH bytes for a write that starts at byte
+ * WRITE_OFS.  Clusters between the old end of file and the cluster
+ * holding WRITE_OFS become a hole, if there is room to record one
+ * and no clusters were reserved past the end of file; the rest get
+ * the reserved clusters first, then new unwritten ones.  Returns
+ * false if the disk is full. */
+static bool
+extend (struct inode *inode, off_t write_ofs, off_t new_length) {
+	struct inode_disk *data = &inode->data;
+	struct fs *fs = inode->fs;
+	uint32_t have = DIV_ROUND_UP (data->length, CLUSTER_BYTES (fs));
+	uint32_t first = write_ofs / CLUSTER_BYTES (fs);
+	uint32_t need = DIV_ROUND_UP (new_length, CLUSTER_BYTES (fs));
+	struct inode_hole *last = data->hole_cnt > 0
+		? &data->holes[data->hole_cnt - 1] : NULL;
+	bool gap = false;
+
+	ASSERT (new_length > data->length);
+
+	if (need > have) {
+		uint32_t chain_cnt, mapped;
+		cluster_t head, tail, prev = chain_last (fs, data, &chain_cnt);
+
+		mapped = mapped_clusters (data, chain_cnt);
+		if (first > have && mapped <= have) {
+			if (last != NULL && last->start + last->length == have)
+				gap = true;
+			else
+				gap = data->hole_cnt < INODE_HOLE_CNT;
+		}
+		if (gap)
+			mapped = first;
+
+		if (need > mapped) {
+			if (!allocate_run (fs, prev + 1, need - mapped, &head, &tail))
+				return false;
+			if (prev == 0)
+				data->start = cluster_to_sector (fs, head);
+			else
+				fat_put (fs, prev, head);
+		}
+	}
+
+	if (gap) {
+		if (last != NULL && last->start + last->length == have)
+			last->length += first - have;
+		else {
+			data->holes[data->hole_cnt].start = have;
+			data->holes[data->hole_cnt].length = first - have;
+			data->hole_cnt++;
+		}
+	}
+
+	data->length = new_length;
+	write_disk_inode (fs, inode->sector, data);
+	return true;
+}
+
 /* List of open inodes, so that opening a single inode twice
  * returns the same `struct inode'. */
 static struct list open_inodes;
@@ -100,12 +509,12 @@ inode_init (void) {
 }
 
 /* Initializes an inode with LENGTH bytes of data and
- * writes the new inode to sector SECTOR on the file system
- * disk.
+ * writes the new inode to sector SECTOR of file system FS.
  * Returns true if successful.
  * Returns false if memory or disk allocation fails. */
 bool
-inode_create (disk_sector_t sector, off_t length, bool directory) {
+inode_create (struct fs *fs, disk_sector_t sector, off_t length,
+              bool directory) {
 	struct inode_disk *disk_inode = NULL;
 	bool success = false;
 
@@ -127,68 +536,34 @@ inode_create (disk_sector_t sector, off_t length, bool directory) {
 		disk_inode->start = 0;
 		
 		#ifdef EFILESYS
-		//새로운 chain을 만들어줘야하니까 0으로 입력해서 new chain이 allocate가 되는지 보고 (free한 공간 충분)
-		cluster_t allocate;
-		size_t count;
-		if (sectors == 0) {
-			disk_write(filesys_disk, sector, disk_inode);
-			success = true;
-		} else {
-			//새로운 클러스터 체인을 일단 생성해줘야한다
-			allocate = fat_create_chain(0);
-			if (allocate == 0) {
-				//fat안에 0인 연속적인 free한 공간이 있어야 하니까 0이 나오면 fail to allocate new cluster인거다
-				//fat_remove_chain(allocate, 0);
-				free(disk_inode);
-				return false;
-			}
-
-			//FAT table안에서 빈 cluster들을 불러와서 파일 크기에 맞게 클러스터 체인을 만들어준다
-			//이때 실제 값들을 넣어주는게 아닌 흩어진 섹터들을 연결해주는 작업만 한다!
-			cluster_t new_clst = allocate;
-			count = sectors;
-			while (count > 0) {
-				new_clst = fat_create_chain(new_clst);
-				if (new_clst == 0) {
-					//chain에 cluster를 추가하는게 실패한거니까 free하고 revmoe해줘야한다
-					// printf("(inode_create) 설마 chain에 clst 추가 실패함?\n");
-					fat_remove_chain(allocate, 0);
-					free(disk_inode);
-					return false;
-				}
-
-				//allocate = new_clst;
-				count--;
-			}
-			//여기까지 나온거면 chain이 다 성공적으로 만들어진거니까 이때 처음 만든 sector를 start로 지정해준다
-			disk_inode->start = cluster_to_sector(allocate);
-		}
-
-		//이제 FAT 테이블에서는 다음 클러스터 번호가 잘 적혀있을거다
-		//이제 또 하나하나씩 들어가서 disk_write을 호출해 클러스터에 해당 파일을 써줘야한다 
-		disk_write(filesys_disk, sector, disk_inode);
-		if (sectors > 0) {
-			static char zeros[DISK_SECTOR_SIZE]; 
-			cluster_t for_write = allocate;
-			while (count > 0) {
-				disk_write(filesys_disk, cluster_to_sector(for_write), zeros);
-				//FAT안에 다음 cluster의 위치가 담겨있기때문에 이렇게 다음 cluster를 찾는다
-				for_write = fat_get(for_write);
-
-				count--;
-			}
+		/* Nothing is allocated up front.  A small file keeps its
+		 * (zeroed) data in the inode; a larger one starts out as one
+		 * hole, which gets clusters as it is written. */
+		if (length <= INODE_INLINE_MAX)
+			disk_inode->inlined = true;
+		else if (sectors > 0) {
+			disk_inode->hole_cnt = 1;
+			disk_inode->holes[0].start = 0;
+			disk_inode->holes[0].length =
+				    DIV_ROUND_UP (length, CLUSTER_BYTES (fs));
 		}
+		write_disk_inode (fs, sector, disk_inode);
+		/* Only the inode's own sector of its cluster is ever read,
+		 * so the rest need not be zeroed. */
+		if (sector_unwritten (fs, sector))
+			fat_set_written (fs, sector_to_cluster (fs, sector));
+		free (disk_inode);
 		success = true;
 		// printf("(inode_create)\n");
 		#else
 		if (free_map_allocate (sectors, &disk_inode->start)) {
-			disk_write (filesys_disk, sector, disk_inode);
+			disk_write (fs->disk, sector, disk_inode);
 			if (sectors > 0) {
 				static char zeros[DISK_SECTOR_SIZE];
 				size_t i;
 
 				for (i = 0; i < sectors; i++) 
-					disk_write (filesys_disk, disk_inode->start + i, zeros); 
+					disk_write (fs->disk, disk_inode->start + i, zeros); 
 			}
 			success = true; 
 		} 
@@ -199,12 +574,12 @@ inode_create (disk_sector_t sector, off_t length, bool directory) {
 	return success;
 }
 
-/* Reads an inode from SECTOR
+/* Reads an inode from SECTOR of FS
  * and returns a `struct inode' that contains it.
  * Returns a null pointer if memory allocation fails. */
 //파일이나 디렉토리를 열때 호출되는 이 함수를 통해서 inode구조체가 생성이 되어 메모리로 올라온다
 struct inode *
-inode_open (disk_sector_t sector) {
+inode_open (struct fs *fs, disk_sector_t sector) {
 	struct list_elem *e;
 	struct inode *inode;
 
@@ -212,7 +587,7 @@ inode_open (disk_sector_t sector) {
 	for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
 			e = list_next (e)) {
 		inode = list_entry (e, struct inode, elem);
-		if (inode->sector == sector) {
+		if (inode->fs == fs && inode->sector == sector) {
 			//printf("여기 들어가?\n");
 			inode_reopen (inode);
 			//printf("inode != NULL? %d\n", inode != NULL);
@@ -226,12 +601,14 @@ inode_open (disk_sector_t sector) {
 		return NULL;
 
 	/* Initialize. */
+	inode->fs = fs;
 	inode->sector = sector;
 	inode->open_cnt = 1;
 	inode->deny_write_cnt = 0;
 	inode->removed = false;
+	inode->mounted = NULL;
 	
-	disk_read (filesys_disk, inode->sector, &inode->data);
+	read_disk_inode (fs, inode->sector, &inode->data);
 	
 	//disk_read(filesys_disk, cluster_to_sector(inode->sector), &inode->data);
 	list_push_front (&open_inodes, &inode->elem);
@@ -253,6 +630,39 @@ inode_get_inumber (const struct inode *inode) {
 	return inode->sector;
 }
 
+/* Returns the file system INODE belongs to. */
+struct fs *
+inode_get_fs (const struct inode *inode) {
+	return inode->fs;
+}
+
+/* Returns the file system mounted on directory INODE, or a null
+ * pointer if there is none. */
+struct fs *
+inode_get_mounted (const struct inode *inode) {
+	return inode->mounted;
+}
+
+/* Records FS as mounted on directory INODE, or with a null FS, that
+ * nothing is.  The mount holds INODE open, so the record lasts as long
+ * as the mount. */
+void
+inode_set_mounted (struct inode *inode, struct fs *fs) {
+	inode->mounted = fs;
+}
+
+/* Returns true if any inode of FS is open. */
+bool
+inode_fs_busy (struct fs *fs) {
+	struct list_elem *e;
+
+	for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
+			e = list_next (e))
+		if (list_entry (e, struct inode, elem)->fs == fs)
+			return true;
+	return false;
+}
+
 /* Closes INODE and writes it to disk.
  * If this was the last reference to INODE, frees its memory.
  * If INODE was also a removed inode, frees its blocks. */
@@ -263,7 +673,7 @@ inode_close (struct inode *inode) {
 		return;
 
 	#ifdef EFILESYS
-		disk_write (filesys_disk, inode->sector, &inode->data);
+		write_disk_inode (inode->fs, inode->sector, &inode->data);
 	#endif
 	/* Release resources if this was the last opener. */
 	if (--inode->open_cnt == 0) {
@@ -273,8 +683,11 @@ inode_close (struct inode *inode) {
 		/* Deallocate blocks if removed. */
 		if (inode->removed) {
 			#ifdef EFILESYS
-				fat_remove_chain(sector_to_cluster(inode->sector), 0);
-				//fat_remove_chain(sector_to_cluster(inode->data.start), 0);
+				fat_remove_chain(inode->fs,
+				                 sector_to_cluster(inode->fs, inode->sector), 0);
+				if (inode->data.start != 0)
+					fat_remove_chain(inode->fs,
+					                 sector_to_cluster(inode->fs, inode->data.start), 0);
 			#else
 				free_map_release (inode->sector, 1);
 				free_map_release (inode->data.start,
@@ -303,6 +716,16 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 	off_t bytes_read = 0;
 	uint8_t *bounce = NULL;
 
+	if (inode->data.inlined) {
+		/* The data came in with the inode; no disk access needed. */
+		if (offset >= inode->data.length || size <= 0)
+			return 0;
+		if (size > inode->data.length - offset)
+			size = inode->data.length - offset;
+		memcpy (buffer, inode->data.inline_data + offset, size);
+		return size;
+	}
+
 	while (size > 0) {
 		/* Disk sector to read, starting byte offset within sector. */
 		disk_sector_t sector_idx = byte_to_sector (inode, offset);
@@ -318,10 +741,29 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 		if (chunk_size <= 0)
 			break;
 
-		if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
-			/* Read full sector directly into caller's buffer. */
-			//printf("sector index: %d", sector_idx);
-			disk_read (filesys_disk, sector_idx, buffer + bytes_read); 
+		/* Holes and unwritten clusters read as zeros.  Directory
+		 * contents are metadata, kept in the buffer cache. */
+		bool zeros = sector_idx == SECTOR_HOLE;
+		bool meta = false;
+#ifdef EFILESYS
+		zeros = zeros || sector_unwritten (inode->fs, sector_idx);
+		meta = inode->data.directory;
+#endif
+
+		if (meta && !zeros)
+			buffer_cache_read (inode->fs->disk, sector_idx, buffer + bytes_read,
+			                   sector_ofs, chunk_size);
+		else if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
+			/* Read full sectors directly into caller's buffer, as
+			 * much of the cluster as the caller wants in one go. */
+			size_t cnt = run_sectors (inode->fs, offset,
+			                          size < inode_left ? size : inode_left);
+			chunk_size = cnt * DISK_SECTOR_SIZE;
+			if (zeros)
+				memset (buffer + bytes_read, 0, chunk_size);
+			else if (!transfer (inode->fs, sector_idx, cnt, buffer + bytes_read,
+			                    false))
+				break;
 		} else {
 			/* Read sector into bounce buffer, then partially copy
 			 * into caller's buffer. */
@@ -331,7 +773,10 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 					break;
 			}
 			//printf("sector index num: %d", sector_idx);
-			disk_read (filesys_disk, sector_idx, bounce);
+			if (zeros)
+				memset (bounce, 0, DISK_SECTOR_SIZE);
+			else
+				disk_read (inode->fs->disk, sector_idx, bounce);
 			memcpy (buffer + bytes_read, bounce + sector_ofs, chunk_size);
 		}
 
@@ -363,60 +808,36 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 	if (inode->deny_write_cnt)
 		return 0;
 
-	disk_sector_t sector_idx = byte_to_sector (inode, offset + size);;
-	if (sector_idx == -1) {
-		//offset에 inode가 data를 가지고 있지 않은 경우이기 때문에 file을 늘려줘야한다
-		int position = offset + size;
-		//inode->data.length는 파일 사이즈 in bytes
-		int start = (inode->data.length + DISK_SECTOR_SIZE - 1) / (DISK_SECTOR_SIZE * SECTORS_PER_CLUSTER);
-		int end = (position + DISK_SECTOR_SIZE - 1) / (DISK_SECTOR_SIZE * SECTORS_PER_CLUSTER);
-		
-		cluster_t new_chain;
-		if (inode->data.length == 0) {
-			//file growth이 필요한거기 때문에 새로운 chain을 생성해줘야한다
-			new_chain = fat_create_chain(0);
-			if (new_chain == 0) {
-				//NOT_REACHED();
-				//chain이 만들어지지 않으면 file growth가 안되고 결국 실제로 데이터가 쓰여지지 않으니까 바로 0으로 반환시킨다
-				// printf("(inode_write_at) fat_create_chain이 error인 경우\n");
-				return 0;
-			} else {
-				//NOT_REACHED();
-				//inode에 정보를 업데이트 해줘야한다
-				inode->data.start = cluster_to_sector(new_chain);
-			}
-		} else {
-			// printf("(inode_write_at) inode->data.symlink_path: %s\n", inode->data.symlink_path);
-			//NOT_REACHED();
-			//이미 데이터 섹션이 있는 경우이기 때문에 그냥 체인을 연결해준다
-			new_chain = sector_to_cluster(inode->data.start);
-			//cluster_t val = fat_get(new_chain);
-			while (fat_get(new_chain) != EOChain) {
-				new_chain = fat_get(new_chain);
-			}
-		}
-		
-		//NOT_REACHED();
-		cluster_t chain = new_chain;
-		for (int i = start; i < end; i++) {
-			chain = fat_create_chain(chain);
-			if (chain == 0) {
-				// printf("(inode_write_at) 연속 chain 만들기가 fail인 경우\n");
-				// if (fat_get(new_chain) != EOChain)
-				// 	fat_remove_chain(fat_get(new_chain), new_chain);
+	if (inode->data.inlined) {
+		if (offset + size <= INODE_INLINE_MAX) {
+			if (size <= 0)
 				return 0;
-			}
+			memcpy (inode->data.inline_data + offset, buffer, size);
+			if (offset + size > inode->data.length)
+				inode->data.length = offset + size;
+			write_disk_inode (inode->fs, inode->sector, &inode->data);
+			return size;
 		}
-		
-		//만약 여기까지 잘 나오면 chain이 우리가 원하는 만큼까지 커지는게 성공한거니까
-		//그럼 inode의 데이터에 length를 우리가 쓰고 싶었던 크기를 넣어주면 된다
-		inode->data.length = position;
-		disk_write(filesys_disk, inode->sector, &inode->data);
+		if (!migrate_inline (inode))
+			return 0;
 	}
 
+	/* Writing past end of file grows the file, leaving a hole
+	 * rather than allocated clusters in any gap. */
+	if (offset + size > inode->data.length
+			&& !extend (inode, offset, offset + size))
+		return 0;
+
 	while (size > 0) {
 		/* Sector to write, starting byte offset within sector. */
-		sector_idx = byte_to_sector(inode, offset);
+		disk_sector_t sector_idx = byte_to_sector(inode, offset);
+		if (sector_idx == SECTOR_HOLE) {
+			sector_idx = fill_hole (inode, offset / CLUSTER_BYTES (inode->fs));
+			if (sector_idx == (disk_sector_t) -1)
+				break;
+			sector_idx += offset / DISK_SECTOR_SIZE
+			              % SECTORS_PER_CLUSTER (inode->fs);
+		}
 		int sector_ofs = offset % DISK_SECTOR_SIZE;
 
 		/* Bytes left in inode, bytes left in sector, lesser of the two. */
@@ -429,9 +850,27 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 		if (chunk_size <= 0)
 			break;
 
-		if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
-			/* Write full sector directly to disk. */
-			disk_write (filesys_disk, sector_idx, buffer + bytes_written); 
+		/* A sector that was never written holds garbage, not zeros. */
+		bool unwritten = false;
+		bool meta = false;
+#ifdef EFILESYS
+		unwritten = sector_unwritten (inode->fs, sector_idx);
+		meta = inode->data.directory;
+#endif
+
+		if (meta)
+			buffer_cache_write (inode->fs->disk, sector_idx,
+			                    buffer + bytes_written, sector_ofs, chunk_size,
+			                    unwritten);
+		else if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
+			/* Write full sectors directly to disk, as much of the
+			 * cluster as the caller supplies in one go. */
+			size_t cnt = run_sectors (inode->fs, offset,
+			                          size < inode_left ? size : inode_left);
+			chunk_size = cnt * DISK_SECTOR_SIZE;
+			if (!transfer (inode->fs, sector_idx, cnt,
+			               (void *) (buffer + bytes_written), true))
+				break;
 		} else {
 			/* We need a bounce buffer. */
 			if (bounce == NULL) {
@@ -443,13 +882,18 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 			/* If the sector contains data before or after the chunk
 			   we're writing, then we need to read in the sector
 			   first.  Otherwise we start with a sector of all zeros. */
-			if (sector_ofs > 0 || chunk_size < sector_left) 
-				disk_read (filesys_disk, sector_idx, bounce);
+			if ((sector_ofs > 0 || chunk_size < sector_left) && !unwritten)
+				disk_read (inode->fs->disk, sector_idx, bounce);
 			else
 				memset (bounce, 0, DISK_SECTOR_SIZE);
 			memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
-			disk_write (filesys_disk, sector_idx, bounce); 
+			disk_write (inode->fs->disk, sector_idx, bounce); 
 		}
+#ifdef EFILESYS
+		if (unwritten)
+			sector_written (inode->fs, sector_idx,
+			                DIV_ROUND_UP (chunk_size, DISK_SECTOR_SIZE));
+#endif
 
 		/* Advance. */
 		size -= chunk_size;
@@ -486,16 +930,200 @@ inode_length (const struct inode *inode) {
 	return inode->data.length;
 }
 
+#ifdef EFILESYS
+/* A growing array of sector ranges, for inode_sync(). */
+struct range_list {
+	struct sector_range *ranges;
+	size_t cnt;
+	size_t capacity;
+	bool failed;                        /* Out of memory? */
+};
+
+/* Adds sectors START (inclusive) through END (exclusive) to LIST,
+ * merging them into the last range if they overlap or touch it. */
+static void
+add_range (struct range_list *list, disk_sector_t start, disk_sector_t end) {
+	struct sector_range *last = list->cnt > 0
+		? &list->ranges[list->cnt - 1] : NULL;
+
+	if (last != NULL && start >= last->start && start <= last->end) {
+		if (end > last->end)
+			last->end = end;
+		return;
+	}
+	if (list->cnt == list->capacity) {
+		size_t capacity = list->capacity > 0 ? list->capacity * 2 : 8;
+		struct sector_range *ranges = realloc (list->ranges,
+				capacity * sizeof *ranges);
+
+		if (ranges == NULL) {
+			list->failed = true;
+			return;
+		}
+		list->ranges = ranges;
+		list->capacity = capacity;
+	}
+	list->ranges[list->cnt].start = start;
+	list->ranges[list->cnt].end = end;
+	list->cnt++;
+}
+#endif
+
+/* Makes INODE durable: its sector, the FAT sectors that chain it and,
+ * for a directory, its data, which is kept in the buffer cache.  A
+ * regular file's data is written straight to disk by inode_write_at(),
+ * so it needs nothing more.  Unless DATASYNC, the in-memory inode is
+ * written to its sector first; either way that sector is synced, for
+ * the length and inline data it holds.
+ *
+ * The sectors are gathered while the caller holds LOCK, which must
+ * keep INODE's chain from changing.  LOCK is released while waiting
+ * for the disk, so that concurrent callers can share one commit, and
+ * is held again on return.  LOCK may be null if nobody else can
+ * change the chain. */
+void
+inode_sync (struct inode *inode, bool datasync, struct lock *lock) {
+	ASSERT (inode != NULL);
+	ASSERT (lock == NULL || lock_held_by_current_thread (lock));
+
+	if (!datasync || inode->data.inlined)
+		write_disk_inode (inode->fs, inode->sector, &inode->data);
+#ifdef EFILESYS
+	struct fs *fs = inode->fs;
+	struct range_list data = { NULL, 0, 0, false };
+	struct range_list fat = { NULL, 0, 0, false };
+	cluster_t clst = sector_to_cluster (fs, inode->sector);
+	size_t i;
+
+	add_range (&data, inode->sector, inode->sector + 1);
+	add_range (&fat, fat_sector (fs, clst), fat_sector (fs, clst) + 1);
+	if (inode->data.start != 0)
+		for (clst = sector_to_cluster (fs, inode->data.start);
+				clst != 0 && clst != EOChain; clst = fat_get (fs, clst)) {
+			disk_sector_t sector = fat_sector (fs, clst);
+
+			add_range (&fat, sector, sector + 1);
+			if (inode->data.directory) {
+				sector = cluster_to_sector (fs, clst);
+				add_range (&data, sector, sector + SECTORS_PER_CLUSTER (fs));
+			}
+		}
+	for (i = 0; i < fat.cnt; i++)
+		add_range (&data, fat.ranges[i].start, fat.ranges[i].end);
+
+	if (lock != NULL)
+		lock_release (lock);
+	if (data.failed || fat.failed)
+		buffer_cache_sync ();
+	else
+		buffer_cache_sync_ranges (fs->disk, data.ranges, data.cnt);
+	if (lock != NULL)
+		lock_acquire (lock);
+
+	free (data.ranges);
+	free (fat.ranges);
+#endif
+}
+
+/* Reserves clusters for bytes OFFSET through OFFSET + LEN - 1 of
+ * INODE, so that writing them later needs no allocation.  Holes in
+ * the range get clusters of their own; past the end of file, the
+ * clusters are taken as one contiguous run where the disk allows.
+ * Nothing is zeroed: new clusters are unwritten and read as zeros.
+ * The file grows to cover the range unless KEEP_SIZE, in which case
+ * the clusters past its end wait in its chain for later writes.
+ * Returns false if the disk is full or INODE may not be written;
+ * clusters reserved by then stay reserved. */
+bool
+inode_allocate (struct inode *inode, off_t offset, off_t len,
+                bool keep_size) {
+	struct inode_disk *data = &inode->data;
+	struct fs *fs = inode->fs;
+	off_t end = offset + len;
+	uint32_t idx, in_file, chain_cnt, mapped, need;
+	cluster_t head, tail, prev;
+
+	ASSERT (offset >= 0 && len > 0 && end > offset);
+
+	if (inode->deny_write_cnt || data->symlink)
+		return false;
+	if (data->inlined) {
+		if (end <= INODE_INLINE_MAX) {
+			if (!keep_size && end > data->length) {
+				data->length = end;
+				write_disk_inode (fs, inode->sector, data);
+			}
+			return true;
+		}
+		if (!migrate_inline (inode))
+			return false;
+	}
+
+	/* Fill the holes within the file. */
+	in_file = DIV_ROUND_UP (end < data->length ? end : data->length,
+	                        CLUSTER_BYTES (fs));
+	for (idx = offset / CLUSTER_BYTES (fs); idx < in_file; idx++) {
+		uint32_t chain_pos;
+
+		if (find_hole (data, idx, &chain_pos) >= 0
+				&& fill_hole (inode, idx) == (disk_sector_t) -1)
+			return false;
+	}
+
+	/* Reserve the rest, from the end of the chain on, in one run. */
+	need = DIV_ROUND_UP (end, CLUSTER_BYTES (fs));
+	prev = chain_last (fs, data, &chain_cnt);
+	mapped = mapped_clusters (data, chain_cnt);
+	if (need > mapped) {
+		if (!allocate_run (fs, prev + 1, need - mapped, &head, &tail))
+			return false;
+		if (prev == 0)
+			data->start = cluster_to_sector (fs, head);
+		else
+			fat_put (fs, prev, head);
+	}
+
+	if (!keep_size && end > data->length)
+		data->length = end;
+	write_disk_inode (fs, inode->sector, data);
+	return true;
+}
+
+/* Fills ST with what stat() reports about INODE.  Counting its
+ * clusters walks its chain in the FAT; holes and inline data take
+ * none. */
+void
+inode_stat (const struct inode *inode, struct stat *st) {
+	uint32_t clusters = 0;
+
+#ifdef EFILESYS
+	if (!inode->data.inlined && inode->data.start != 0) {
+		cluster_t clst = sector_to_cluster (inode->fs, inode->data.start);
+
+		for (; clst != 0 && clst != EOChain; clst = fat_get (inode->fs, clst))
+			clusters++;
+	}
+#else
+	clusters = bytes_to_sectors (inode->data.length);
+#endif
+
+	st->st_ino = inode->sector;
+	st->st_size = inode->data.length;
+	st->st_blocks = clusters;
+	st->st_type = inode->data.symlink ? DT_LNK
+	              : inode->data.directory ? DT_DIR : DT_REG;
+}
+
 void
 create_directory_inode (struct inode *inode) {
 	inode->data.directory = true;
-	disk_write(filesys_disk, inode->sector, &inode->data);
+	write_disk_inode (inode->fs, inode->sector, &inode->data);
 }
 
 void
 create_file_inode (struct inode *inode) {
 	inode->data.directory = false;
-	disk_write(filesys_disk, inode->sector, &inode->data);
+	write_disk_inode (inode->fs, inode->sector, &inode->data);
 }
 
 bool
@@ -504,7 +1132,7 @@ inode_is_directory (const struct inode *inode) {
 }
 
 bool
-create_link_inode (disk_sector_t sector, char *target) {
+create_link_inode (struct fs *fs, disk_sector_t sector, char *target) {
 
 	/*
 	struct inode_disk *disk_for_inode = NULL;
@@ -540,7 +1168,7 @@ create_link_inode (disk_sector_t sector, char *target) {
 		return false;
 	}
 
-	struct inode *inode = inode_open(sector);
+	struct inode *inode = inode_open(fs, sector);
 	if (inode == NULL) {
 		inode_close(inode);
 		return false;
@@ -0,0 +1,421 @@
+/* journal.c: Write-ahead log for file system metadata. */
+
+#include "filesys/journal.h"
+#include <debug.h>
+#include <hash.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Metadata (FAT, inode and directory sectors) is changed only in the
+   buffer cache.  Every so often, or when someone asks for durability,
+   the cache takes a consistent snapshot of the sectors changed since
+   the last time and hands it here as a transaction, which is appended
+   to a circular log with a single sequential write.  The changed
+   sectors themselves stay dirty in the cache and reach their home
+   locations lazily, when they are evicted or at unmount.
+
+   The journal area starts with a superblock that records where the
+   oldest transaction still needed lives.  Each transaction is a
+   descriptor sector listing the sectors it carries, their contents,
+   sectors listing revoked sectors, and a commit sector holding a
+   checksum of all of that, so a transaction torn by a crash is
+   recognized and ignored.
+
+   Space is reclaimed without writing anything home: when the log is
+   about to run out of room, the next transaction carries every dirty
+   sector in the cache instead of just the changed ones.  Together with
+   the home locations, that transaction supersedes everything before
+   it, so once it is on disk the superblock can point at it.  The log
+   must therefore always have room for one such "full" transaction.
+
+   A sector that is freed while an older copy of it is in the log is
+   revoked, so that mounting does not write the stale copy over
+   whatever the sector is reused for.  Mounting replays the committed
+   transactions in order, skipping revoked sectors, and then starts an
+   empty log; it never scans anything but the log. */
+
+#define JOURNAL_MAGIC 0x4a524e4c            /* "JRNL". */
+#define DESC_MAGIC 0x44455343               /* "DESC". */
+#define COMMIT_MAGIC 0x434d4954             /* "CMIT". */
+
+/* Revoked sector numbers per revoke sector. */
+#define REVOKES_PER_SECTOR (DISK_SECTOR_SIZE / sizeof (disk_sector_t))
+
+/* Most sectors in the log, and so the most sectors it can hold copies
+   of or revoke at any time. */
+#define LOG_MAX (JOURNAL_SECTORS - 1)
+#define REVOKE_SECTORS_MAX DIV_ROUND_UP (LOG_MAX, REVOKES_PER_SECTOR)
+
+/* Largest transaction, in sectors. */
+#define RECORD_MAX (1 + JOURNAL_MAX_BLOCKS + REVOKE_SECTORS_MAX + 1)
+
+/* First sector of the journal area. */
+struct journal_super {
+	uint32_t magic;                     /* JOURNAL_MAGIC. */
+	uint32_t tail;                      /* Log offset of oldest transaction. */
+	uint64_t seq;                       /* Its sequence number. */
+};
+
+/* First sector of a transaction. */
+struct journal_desc {
+	uint32_t magic;                     /* DESC_MAGIC. */
+	uint32_t block_cnt;                 /* Sectors logged. */
+	uint64_t seq;                       /* Sequence number. */
+	uint32_t revoke_cnt;                /* Sectors revoked. */
+	disk_sector_t sectors[JOURNAL_MAX_BLOCKS]; /* Home of each block. */
+};
+
+/* Last sector of a transaction. */
+struct journal_commit {
+	uint32_t magic;                     /* COMMIT_MAGIC. */
+	uint32_t pad;
+	uint64_t seq;                       /* Same as descriptor's. */
+	uint64_t checksum;                  /* Of all preceding sectors. */
+};
+
+static struct disk *disk;               /* Null if there is no journal. */
+static disk_sector_t super_sector;      /* Superblock. */
+static disk_sector_t log_start;         /* First sector of the log. */
+static size_t log_size;                 /* Sectors in the log. */
+static size_t tail, head, used;         /* Offsets in the log, and use. */
+static uint64_t next_seq;               /* Sequence number of next commit. */
+
+/* The transaction being committed. */
+static uint8_t *rec;                    /* RECORD_MAX sectors. */
+static size_t rec_len;                  /* Sectors in use. */
+static bool rec_full;                   /* Supersedes earlier ones? */
+
+/* Sectors with a copy in the log, and sectors revoked since the last
+   commit.  Both are bounded by the size of the log. */
+static disk_sector_t logged[LOG_MAX];
+static size_t logged_cnt;
+static disk_sector_t revoked[LOG_MAX];
+static size_t revoked_cnt;
+
+/* Returns sector IDX of the record buffer. */
+static void *
+rec_sector (size_t idx) {
+	return rec + idx * DISK_SECTOR_SIZE;
+}
+
+/* Reads or writes, according to WRITE, the CNT sectors at offset OFS of
+   the log, wrapping around its end, from or into BUFFER. */
+static void
+log_io (size_t ofs, size_t cnt, void *buffer, bool write) {
+	struct disk_request reqs[RECORD_MAX / DISK_MAX_SECTORS + 2];
+	size_t req_cnt = 0, i;
+	uint8_t *p = buffer;
+
+	ASSERT (cnt <= RECORD_MAX);
+	while (cnt > 0) {
+		size_t chunk = log_size - ofs;
+
+		if (chunk > cnt)
+			chunk = cnt;
+		if (chunk > DISK_MAX_SECTORS)
+			chunk = DISK_MAX_SECTORS;
+		if (write)
+			disk_write_async (disk, log_start + ofs, chunk, p, &reqs[req_cnt++],
+					NULL, NULL);
+		else
+			disk_read_async (disk, log_start + ofs, chunk, p, &reqs[req_cnt++],
+					NULL, NULL);
+		p += chunk * DISK_SECTOR_SIZE;
+		ofs = (ofs + chunk) % log_size;
+		cnt -= chunk;
+	}
+	for (i = 0; i < req_cnt; i++)
+		disk_wait (&reqs[i]);
+}
+
+/* Writes the superblock, saying that the log starts at TAIL with
+   transaction SEQ. */
+static void
+write_super (uint64_t seq) {
+	static struct journal_super *sb;
+
+	if (sb == NULL)
+		sb = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+	sb->magic = JOURNAL_MAGIC;
+	sb->tail = tail;
+	sb->seq = seq;
+	disk_write (disk, super_sector, sb);
+}
+
+/* Sets up the in-memory state for a journal of CNT sectors starting at
+   START on disk D. */
+static void
+setup (struct disk *d, disk_sector_t start, disk_sector_t cnt) {
+	if (cnt < 2 * RECORD_MAX + 1 || cnt > JOURNAL_SECTORS)
+		PANIC ("journal: bad size %"PRDSNu, cnt);
+	if (rec == NULL)
+		rec = palloc_get_multiple (PAL_ASSERT,
+				DIV_ROUND_UP (RECORD_MAX * DISK_SECTOR_SIZE, PGSIZE));
+	disk = d;
+	super_sector = start;
+	log_start = start + 1;
+	log_size = cnt - 1;
+	tail = head = used = 0;
+	logged_cnt = revoked_cnt = 0;
+}
+
+/* Creates an empty journal in the CNT sectors starting at START on
+   disk D, and uses it from now on. */
+void
+journal_format (struct disk *d, disk_sector_t start, disk_sector_t cnt) {
+	setup (d, start, cnt);
+	next_seq = 1;
+	write_super (next_seq);
+}
+
+/* Reads the transaction at offset OFS of the log into the record
+   buffer and returns its length in sectors, or 0 if there is no
+   complete transaction SEQ there that fits in LEFT sectors. */
+static size_t
+read_record (size_t ofs, uint64_t seq, size_t left) {
+	struct journal_desc *desc = rec_sector (0);
+	struct journal_commit *commit;
+	size_t len;
+
+	log_io (ofs, 1, desc, false);
+	if (desc->magic != DESC_MAGIC || desc->seq != seq
+			|| desc->block_cnt > JOURNAL_MAX_BLOCKS
+			|| desc->revoke_cnt > LOG_MAX)
+		return 0;
+	len = 2 + desc->block_cnt
+	      + DIV_ROUND_UP (desc->revoke_cnt, REVOKES_PER_SECTOR);
+	if (len > left)
+		return 0;
+
+	log_io ((ofs + 1) % log_size, len - 1, rec_sector (1), false);
+	commit = rec_sector (len - 1);
+	if (commit->magic != COMMIT_MAGIC || commit->seq != seq
+			|| commit->checksum != hash_bytes (rec,
+			                                   (len - 1) * DISK_SECTOR_SIZE))
+		return 0;
+	return len;
+}
+
+/* Returns the revoked sectors of the transaction in the record
+   buffer. */
+static disk_sector_t *
+record_revokes (void) {
+	struct journal_desc *desc = rec_sector (0);
+
+	return rec_sector (1 + desc->block_cnt);
+}
+
+/* Opens the journal in the CNT sectors starting at START on disk D:
+   replays every committed transaction into the home locations and
+   starts an empty log after them. */
+void
+journal_open (struct disk *d, disk_sector_t start, disk_sector_t cnt) {
+	struct journal_super *sb;
+	uint64_t *revoke_seq;
+	size_t ofs, len, rec_cnt, i, j;
+	uint64_t seq;
+
+	setup (d, start, cnt);
+
+	sb = palloc_get_page (PAL_ASSERT);
+	disk_read (d, start, sb);
+	if (sb->magic != JOURNAL_MAGIC || sb->tail >= log_size) {
+		palloc_free_page (sb);
+		journal_format (d, start, cnt);
+		return;
+	}
+	tail = sb->tail;
+	seq = sb->seq;
+	palloc_free_page (sb);
+
+	/* First pass: find the committed transactions and gather the
+	   latest revocation of each sector. */
+	revoke_seq = palloc_get_page (PAL_ASSERT);
+	ASSERT (LOG_MAX * sizeof *revoke_seq <= PGSIZE);
+	ofs = tail;
+	rec_cnt = 0;
+	while ((len = read_record (ofs, seq + rec_cnt, log_size - used)) > 0) {
+		struct journal_desc *desc = rec_sector (0);
+		disk_sector_t *r = record_revokes ();
+
+		for (i = 0; i < desc->revoke_cnt; i++) {
+			for (j = 0; j < revoked_cnt && revoked[j] != r[i]; j++)
+				continue;
+			if (j == revoked_cnt && revoked_cnt < LOG_MAX)
+				revoked[revoked_cnt++] = r[i];
+			if (j < revoked_cnt)
+				revoke_seq[j] = desc->seq;
+		}
+		ofs = (ofs + len) % log_size;
+		used += len;
+		rec_cnt++;
+	}
+
+	/* Second pass: write each logged sector home, in log order, unless
+	   it was revoked later on. */
+	ofs = tail;
+	for (i = 0; i < rec_cnt; i++) {
+		struct journal_desc *desc = rec_sector (0);
+
+		len = read_record (ofs, seq + i, log_size);
+		ASSERT (len > 0);
+		for (j = 0; j < desc->block_cnt; j++) {
+			size_t k;
+
+			for (k = 0; k < revoked_cnt; k++)
+				if (revoked[k] == desc->sectors[j] && revoke_seq[k] >= desc->seq)
+					break;
+			if (k == revoked_cnt)
+				disk_write (d, desc->sectors[j], rec_sector (1 + j));
+		}
+		ofs = (ofs + len) % log_size;
+	}
+	palloc_free_page (revoke_seq);
+	if (rec_cnt > 0)
+		printf ("journal: replayed %zu transactions\n", rec_cnt);
+
+	/* Everything is home now. */
+	revoked_cnt = 0;
+	tail = head = ofs;
+	used = 0;
+	next_seq = seq + rec_cnt;
+	write_super (next_seq);
+}
+
+/* Returns the disk with the journal, or a null pointer if journaling
+   is off. */
+struct disk *
+journal_disk (void) {
+	return disk;
+}
+
+/* Returns true if the next transaction, with BLOCK_CNT changed
+   sectors, must carry every dirty sector so that the log can start
+   over at it. */
+bool
+journal_need_full (size_t block_cnt) {
+	size_t len = 2 + block_cnt + DIV_ROUND_UP (revoked_cnt, REVOKES_PER_SECTOR);
+
+	return used + len + RECORD_MAX > log_size;
+}
+
+/* Returns the buffer for the contents of the IDX'th sector of the
+   next transaction. */
+void *
+journal_slot (size_t idx) {
+	ASSERT (idx < JOURNAL_MAX_BLOCKS);
+
+	return rec_sector (1 + idx);
+}
+
+/* Returns the index of SECTOR in the CNT-element array SET, or CNT. */
+static size_t
+find (const disk_sector_t set[], size_t cnt, disk_sector_t sector) {
+	size_t i;
+
+	for (i = 0; i < cnt; i++)
+		if (set[i] == sector)
+			break;
+	return i;
+}
+
+/* Builds the next transaction from the CNT SECTORS whose contents
+   are in journal_slot(0) onward, plus the sectors revoked so far.
+   FULL says whether they are all the dirty sectors.  Returns false if
+   there is nothing to commit. */
+bool
+journal_prepare (const disk_sector_t sectors[], size_t cnt, bool full) {
+	struct journal_desc *desc = rec_sector (0);
+	size_t i;
+
+	ASSERT (cnt <= JOURNAL_MAX_BLOCKS);
+	if (cnt == 0 && revoked_cnt == 0 && !full)
+		return false;
+
+	memset (desc, 0, DISK_SECTOR_SIZE);
+	desc->magic = DESC_MAGIC;
+	desc->block_cnt = cnt;
+	desc->revoke_cnt = revoked_cnt;
+	memcpy (desc->sectors, sectors, cnt * sizeof *sectors);
+	memset (rec_sector (1 + cnt), 0,
+	        DIV_ROUND_UP (revoked_cnt, REVOKES_PER_SECTOR) * DISK_SECTOR_SIZE);
+	memcpy (rec_sector (1 + cnt), revoked, revoked_cnt * sizeof *revoked);
+	rec_len = 2 + cnt + DIV_ROUND_UP (revoked_cnt, REVOKES_PER_SECTOR);
+	rec_full = full;
+	revoked_cnt = 0;
+
+	if (full)
+		logged_cnt = 0;
+	for (i = 0; i < cnt; i++)
+		if (find (logged, logged_cnt, sectors[i]) == logged_cnt) {
+			ASSERT (logged_cnt < LOG_MAX);
+			logged[logged_cnt++] = sectors[i];
+		}
+	return true;
+}
+
+/* Appends the transaction built by journal_prepare() to the log and
+   waits until it is on disk. */
+void
+journal_write (void) {
+	struct journal_desc *desc = rec_sector (0);
+	struct journal_commit *commit = rec_sector (rec_len - 1);
+	size_t start = head;
+
+	ASSERT (used + rec_len <= log_size);
+
+	desc->seq = next_seq;
+	memset (commit, 0, DISK_SECTOR_SIZE);
+	commit->magic = COMMIT_MAGIC;
+	commit->seq = next_seq;
+	commit->checksum = hash_bytes (rec, (rec_len - 1) * DISK_SECTOR_SIZE);
+	log_io (head, rec_len, rec, true);
+
+	head = (head + rec_len) % log_size;
+	used += rec_len;
+	if (rec_full) {
+		/* Nothing before this transaction is needed any more. */
+		tail = start;
+		used = rec_len;
+		write_super (next_seq);
+	}
+	next_seq++;
+}
+
+/* Records that SECTOR was freed, so that no older copy of it in the
+   log is replayed. */
+void
+journal_revoke (disk_sector_t sector) {
+	size_t i = find (logged, logged_cnt, sector);
+
+	if (i == logged_cnt)
+		return;
+	logged[i] = logged[--logged_cnt];
+	if (find (revoked, revoked_cnt, sector) == revoked_cnt)
+		revoked[revoked_cnt++] = sector;
+}
+
+/* Records that SECTOR is in use again, cancelling a revocation that
+   has not been committed yet. */
+void
+journal_unrevoke (disk_sector_t sector) {
+	size_t i = find (revoked, revoked_cnt, sector);
+
+	if (i < revoked_cnt)
+		revoked[i] = revoked[--revoked_cnt];
+}
+
+/* Empties the log.  The caller must have written every logged sector
+   home. */
+void
+journal_checkpoint (void) {
+	if (disk == NULL)
+		return;
+	tail = head;
+	used = 0;
+	logged_cnt = 0;
+	write_super (next_seq);
+}
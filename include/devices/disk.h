@@ -2,11 +2,18 @@
 #define DEVICES_DISK_H
 
 #include <inttypes.h>
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
+#include "threads/synch.h"
 
 /* Size of a disk sector in bytes. */
 #define DISK_SECTOR_SIZE 512
 
+/* Largest number of sectors a single request may move. */
+#define DISK_MAX_SECTORS 64
+
 /* Index of a disk sector within a disk.
  * Good enough for disks up to 2 TB. */
 typedef uint32_t disk_sector_t;
@@ -15,13 +22,76 @@ typedef uint32_t disk_sector_t;
  * printf ("sector=%"PRDSNu"\n", sector); */
 #define PRDSNu PRIu32
 
+struct disk;
+struct disk_request;
+
+/* Called when an asynchronous request completes.  It may run in an
+ * interrupt handler, so it must not sleep.  From the call on, the
+ * request belongs to the callee again. */
+typedef void disk_done_func (struct disk_request *, void *aux);
+
+/* A pending transfer of SEC_CNT consecutive sectors starting at
+ * SEC_NO.  Requests that the scheduler merges into this one are kept,
+ * in sector order, on MERGED; they are completed together with it. */
+struct disk_request {
+	disk_sector_t sec_no;               /* First sector. */
+	size_t sec_cnt;                     /* Number of sectors. */
+	bool write;                         /* True for writes. */
+	void *buffer;                       /* SEC_CNT * DISK_SECTOR_SIZE bytes. */
+	int64_t deadline;                   /* Tick by which to serve it. */
+
+	size_t total_cnt;                   /* Sectors, including MERGED. */
+	struct list merged;                 /* Requests merged into this one. */
+
+	struct list_elem elem;              /* Queue/dispatch list element. */
+	struct list_elem fifo_elem;         /* FIFO list element (deadline). */
+	struct list_elem merge_elem;        /* Element in another's MERGED. */
+
+	disk_done_func *done_func;          /* Completion callback, or null. */
+	void *done_aux;                     /* Passed to DONE_FUNC. */
+	struct semaphore done;              /* Up'd on completion if no callback. */
+};
+
+/* A driver for disks that are not on the legacy ATA channels. */
+struct disk_driver {
+	const char *type;                   /* Short description, e.g. "virtio". */
+	/* Starts REQ on the disk.  The driver calls disk_complete() once
+	   REQ and everything merged into it are done. */
+	void (*submit) (struct disk *, struct disk_request *);
+};
+
 void disk_init (void);
+bool disk_set_iosched (const char *name);
 void disk_print_stats (void);
 
 struct disk *disk_get (int chan_no, int dev_no);
+struct disk *disk_get_by_name (const char *name);
 disk_sector_t disk_size (struct disk *);
 void disk_read (struct disk *, disk_sector_t, void *);
 void disk_write (struct disk *, disk_sector_t, const void *);
 
+void disk_read_async (struct disk *, disk_sector_t, size_t cnt, void *,
+		struct disk_request *, disk_done_func *, void *aux);
+void disk_write_async (struct disk *, disk_sector_t, size_t cnt, const void *,
+		struct disk_request *, disk_done_func *, void *aux);
+void disk_wait (struct disk_request *);
+
+/* What a disk is used for.  Each role defaults to one of the ATA
+ * disks but can be pointed at any disk from the command line. */
+enum disk_role {
+	DISK_FILESYS,                       /* File system, default hd0:1. */
+	DISK_SWAP,                          /* Swap, default hd1:1. */
+	DISK_ROLE_CNT
+};
+
+bool disk_set_role (enum disk_role, const char *name);
+struct disk *disk_get_role (enum disk_role);
+bool disk_is_reserved (struct disk *);
+
+struct disk *disk_register (const struct disk_driver *,
+		disk_sector_t capacity, void *aux);
+void *disk_driver_data (struct disk *);
+void disk_complete (struct disk *, struct disk_request *);
+
 void 	register_disk_inspect_intr ();
 #endif /* devices/disk.h */
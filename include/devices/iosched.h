@@ -0,0 +1,44 @@
+#ifndef DEVICES_IOSCHED_H
+#define DEVICES_IOSCHED_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "devices/disk.h"
+
+/* Largest number of sectors a merged request may cover.  ATA can
+ * move up to 256 sectors per command; we stay well under that so a
+ * single merged request cannot monopolize the channel. */
+#define IOSCHED_MAX_SECTORS DISK_MAX_SECTORS
+
+/* Per-disk queue of pending requests.  Which of the lists are used,
+ * and how, is up to the scheduler. */
+struct iosched_queue {
+	const struct iosched *sched;        /* Scheduling policy. */
+	struct list sorted[2];              /* Sector-sorted, [0]=read, [1]=write. */
+	struct list fifo[2];                /* Arrival order, [0]=read, [1]=write. */
+	disk_sector_t head;                 /* Sector after the last dispatched. */
+	int writes_starved;                 /* Read batches since last write. */
+	size_t cnt;                         /* Number of queued requests. */
+	long long merge_cnt;                /* Number of merges performed. */
+};
+
+/* An I/O scheduling policy. */
+struct iosched {
+	const char *name;
+	/* Queues REQ, merging it into a queued request if possible. */
+	void (*add) (struct iosched_queue *, struct disk_request *);
+	/* Removes and returns the request to dispatch next. */
+	struct disk_request *(*next) (struct iosched_queue *);
+};
+
+extern const struct iosched iosched_noop;
+extern const struct iosched iosched_clook;
+extern const struct iosched iosched_deadline;
+
+const struct iosched *iosched_find (const char *name);
+void iosched_queue_init (struct iosched_queue *, const struct iosched *);
+bool iosched_empty (const struct iosched_queue *);
+
+#endif /* devices/iosched.h */
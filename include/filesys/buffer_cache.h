@@ -0,0 +1,34 @@
+#ifndef FILESYS_BUFFER_CACHE_H
+#define FILESYS_BUFFER_CACHE_H
+
+#include <stdbool.h>
+#include "devices/disk.h"
+
+/* A cached disk sector. */
+struct cache_block;
+
+/* Sectors START (inclusive) through END (exclusive) of a disk. */
+struct sector_range {
+	disk_sector_t start;
+	disk_sector_t end;
+};
+
+void buffer_cache_init (void);
+struct cache_block *buffer_cache_pin (struct disk *, disk_sector_t, bool load);
+void *buffer_cache_data (struct cache_block *);
+void buffer_cache_mark_dirty (struct cache_block *);
+void buffer_cache_unpin (struct cache_block *);
+void buffer_cache_read (struct disk *, disk_sector_t, void *,
+		size_t ofs, size_t size);
+void buffer_cache_write (struct disk *, disk_sector_t, const void *,
+		size_t ofs, size_t size, bool fresh);
+void buffer_cache_discard (struct disk *, disk_sector_t start,
+		disk_sector_t end);
+void buffer_cache_flush_range (struct disk *, disk_sector_t start,
+		disk_sector_t end);
+void buffer_cache_flush (void);
+void buffer_cache_sync (void);
+void buffer_cache_sync_ranges (struct disk *, const struct sector_range *,
+		size_t cnt);
+
+#endif /* filesys/buffer_cache.h */
@@ -8,32 +8,48 @@
 #include <stddef.h>
 #include <stdint.h>
 
+struct fs;
+
 typedef uint32_t cluster_t;  /* Index of a cluster within FAT. */
 
 #define FAT_MAGIC 0xEB3C9000 /* MAGIC string to identify FAT disk */
 #define EOChain 0x0FFFFFFF   /* End of cluster chain */
+#define FAT_UNWRITTEN 0x80000000 /* Entry flag: cluster never written */
 
-/* Sectors of FAT information. */
-#define SECTORS_PER_CLUSTER 1 /* Number of sectors per cluster */
+/* Sectors of FAT information.  The cluster size is chosen when the
+   disk is formatted and read back from its boot sector. */
+#define SECTORS_PER_CLUSTER(FS) (fat_sectors_per_cluster (FS))
+#define MAX_SECTORS_PER_CLUSTER 64 /* Largest supported cluster size. */
 #define FAT_BOOT_SECTOR 0     /* FAT boot sector. */
 #define ROOT_DIR_CLUSTER 1    /* Cluster for the root directory */
 
-void fat_init (void);
-void fat_open (void);
-void fat_close (void);
-void fat_create (void);
-void fat_close (void);
+bool fat_init (struct fs *);
+void fat_open (struct fs *);
+void fat_close (struct fs *);
+void fat_create (struct fs *);
+void fat_done (struct fs *);
+bool fat_has_journal (struct fs *);
+bool fat_set_cluster_size (unsigned int sectors);
+unsigned int fat_sectors_per_cluster (struct fs *);
 
 cluster_t fat_create_chain (
+    struct fs *,
     cluster_t clst /* Cluster # to stretch, 0: Create a new chain */
 );
+cluster_t fat_allocate_run (struct fs *, cluster_t hint, size_t cnt,
+                            cluster_t *tail);
 void fat_remove_chain (
+    struct fs *,
     cluster_t clst, /* Cluster # to be removed */
     cluster_t pclst /* Previous cluster of clst, 0: clst is the start of chain */
 );
-cluster_t fat_get (cluster_t clst);
-void fat_put (cluster_t clst, cluster_t val);
-disk_sector_t cluster_to_sector (cluster_t clst);
-cluster_t sector_to_cluster (disk_sector_t sector);
+cluster_t fat_get (struct fs *, cluster_t clst);
+void fat_put (struct fs *, cluster_t clst, cluster_t val);
+bool fat_is_unwritten (struct fs *, cluster_t clst);
+void fat_set_written (struct fs *, cluster_t clst);
+void fat_flush (struct fs *);
+disk_sector_t fat_sector (struct fs *, cluster_t clst);
+disk_sector_t cluster_to_sector (struct fs *, cluster_t clst);
+cluster_t sector_to_cluster (struct fs *, disk_sector_t sector);
 
 #endif /* filesys/fat.h */
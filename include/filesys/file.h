@@ -1,9 +1,11 @@
 #ifndef FILESYS_FILE_H
 #define FILESYS_FILE_H
 
+#include <stdbool.h>
 #include "filesys/off_t.h"
 
 struct inode;
+struct lock;
 
 /* Opening and closing files. */
 struct file *file_open (struct inode *);
@@ -27,6 +29,9 @@ void file_seek (struct file *, off_t);
 off_t file_tell (struct file *);
 off_t file_length (struct file *);
 
+/* Durability. */
+void file_sync (struct file *, bool datasync, struct lock *);
+
 struct inode *get_file_inode (struct file *file);
 
 #endif /* filesys/file.h */
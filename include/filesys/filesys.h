@@ -1,6 +1,7 @@
 #ifndef FILESYS_FILESYS_H
 #define FILESYS_FILESYS_H
 
+#include <list.h>
 #include <stdbool.h>
 #include "filesys/off_t.h"
 
@@ -11,11 +12,28 @@
 /* Disk used for file system. */
 extern struct disk *filesys_disk;
 
+/* A file system: the root one, or one mounted on a directory. */
+struct fs {
+	struct disk *disk;                  /* Disk that holds it. */
+	struct fat_fs *fat;                 /* Its FAT, set up by fat_init(). */
+	struct inode *mount_point;          /* Directory it is mounted on,
+	                                       or null for the root. */
+	struct list_elem elem;              /* Element in mount list. */
+};
+
+/* The file system on FILESYS_DISK. */
+extern struct fs *root_fs;
+
 void filesys_init (bool format);
 void filesys_done (void);
+void filesys_sync (void);
 bool filesys_create (const char *name, off_t initial_size);
 struct file *filesys_open (const char *name);
 bool filesys_remove (const char *name);
+struct inode *filesys_lookup (const char *path);
+bool filesys_format (struct disk *);
+int filesys_mount (const char *path, int chan_no, int dev_no);
+int filesys_umount (const char *path);
 struct dir *parsing(struct dir *dir, char *path, char *final_name);
 
 #endif /* filesys/filesys.h */
@@ -6,12 +6,19 @@
 #include "devices/disk.h"
 
 struct bitmap;
+struct fs;
+struct lock;
+struct stat;
 
 void inode_init (void);
-bool inode_create (disk_sector_t, off_t, bool);
-struct inode *inode_open (disk_sector_t);
+bool inode_create (struct fs *, disk_sector_t, off_t, bool);
+struct inode *inode_open (struct fs *, disk_sector_t);
 struct inode *inode_reopen (struct inode *);
 disk_sector_t inode_get_inumber (const struct inode *);
+struct fs *inode_get_fs (const struct inode *);
+struct fs *inode_get_mounted (const struct inode *);
+void inode_set_mounted (struct inode *, struct fs *);
+bool inode_fs_busy (struct fs *);
 void inode_close (struct inode *);
 void inode_remove (struct inode *);
 off_t inode_read_at (struct inode *, void *, off_t size, off_t offset);
@@ -19,11 +26,14 @@ off_t inode_write_at (struct inode *, const void *, off_t size, off_t offset);
 void inode_deny_write (struct inode *);
 void inode_allow_write (struct inode *);
 off_t inode_length (const struct inode *);
+void inode_sync (struct inode *, bool datasync, struct lock *);
+void inode_stat (const struct inode *, struct stat *);
+bool inode_allocate (struct inode *, off_t offset, off_t len, bool keep_size);
 // project 4
 void create_directory_inode (struct inode *inode);
 void create_file_inode (struct inode *inode);
 bool inode_is_directory (const struct inode *inode);
-bool create_link_inode (disk_sector_t sector, char *target);
+bool create_link_inode (struct fs *fs, disk_sector_t sector, char *target);
 bool check_symlink(struct inode *inode);
 char copy_inode_link (struct inode *inode, char *path);
 char inode_data_symlink_path (struct inode *inode);
@@ -0,0 +1,31 @@
+#ifndef FILESYS_JOURNAL_H
+#define FILESYS_JOURNAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "devices/disk.h"
+
+/* Most metadata sectors one transaction can log. */
+#define JOURNAL_MAX_BLOCKS 64
+
+/* Size of the journal created when a disk is formatted, in sectors,
+   and the smallest disk that gets one. */
+#define JOURNAL_SECTORS 256
+#define JOURNAL_MIN_DISK (8 * JOURNAL_SECTORS)
+
+void journal_format (struct disk *, disk_sector_t start, disk_sector_t cnt);
+void journal_open (struct disk *, disk_sector_t start, disk_sector_t cnt);
+struct disk *journal_disk (void);
+
+/* Used by the buffer cache, with its lock held. */
+bool journal_need_full (size_t block_cnt);
+void *journal_slot (size_t idx);
+bool journal_prepare (const disk_sector_t sectors[], size_t cnt, bool full);
+void journal_revoke (disk_sector_t);
+void journal_unrevoke (disk_sector_t);
+
+/* Used by the buffer cache, without its lock. */
+void journal_write (void);
+void journal_checkpoint (void);
+
+#endif /* filesys/journal.h */
@@ -0,0 +1,21 @@
+#ifndef __LIB_DIRENT_H
+#define __LIB_DIRENT_H
+
+#include <stdint.h>
+
+/* Types of file reported in struct dirent's D_TYPE. */
+#define DT_REG 1                    /* Regular file. */
+#define DT_DIR 2                    /* Directory. */
+#define DT_LNK 3                    /* Symbolic link. */
+
+/* A directory entry, as getdents() packs them into its buffer.
+   Each entry is D_RECLEN bytes long, including its null-terminated
+   name and padding, and the next one follows right after it. */
+struct dirent {
+	uint32_t d_ino;                 /* Inode number. */
+	uint16_t d_reclen;              /* Length of this record. */
+	uint8_t d_type;                 /* DT_REG, DT_DIR or DT_LNK. */
+	char d_name[];                  /* Null-terminated file name. */
+};
+
+#endif /* lib/dirent.h */
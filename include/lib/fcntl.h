@@ -0,0 +1,8 @@
+#ifndef __LIB_FCNTL_H
+#define __LIB_FCNTL_H
+
+/* Flags for fallocate()'s MODE. */
+#define FALLOC_FL_KEEP_SIZE 0x1     /* Reserve space, but leave the
+                                       file's length alone. */
+
+#endif /* lib/fcntl.h */
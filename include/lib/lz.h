@@ -0,0 +1,19 @@
+#ifndef __LIB_LZ_H
+#define __LIB_LZ_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Size of the scratch memory lz_compress() needs. */
+#define LZ_HASH_BITS 12
+#define LZ_WORK_SIZE ((1 << LZ_HASH_BITS) * sizeof (uint16_t))
+
+/* Largest input lz_compress() accepts. */
+#define LZ_MAX_INPUT 65535
+
+size_t lz_compress (const void *src, size_t src_len, void *dst, size_t dst_cap,
+		void *work);
+size_t lz_decompress (const void *src, size_t src_len, void *dst,
+		size_t dst_cap);
+
+#endif /* lib/lz.h */
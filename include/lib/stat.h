@@ -0,0 +1,15 @@
+#ifndef __LIB_STAT_H
+#define __LIB_STAT_H
+
+#include <dirent.h>
+#include <stdint.h>
+
+/* What stat() and fstat() report about a file. */
+struct stat {
+	uint32_t st_ino;                /* Inode number. */
+	uint32_t st_size;               /* Length in bytes. */
+	uint32_t st_blocks;             /* Clusters holding its data. */
+	uint8_t st_type;                /* DT_REG, DT_DIR or DT_LNK. */
+};
+
+#endif /* lib/stat.h */
@@ -36,6 +36,14 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	SYS_FSYNC,                  /* Write a file's data and inode to disk. */
+	SYS_FDATASYNC,              /* Write a file's data to disk. */
+	SYS_SYNC,                   /* Write all file system changes to disk. */
+	SYS_GETDENTS,               /* Reads many directory entries. */
+	SYS_STAT,                   /* Describes the file a path names. */
+	SYS_FSTAT,                  /* Describes an open file. */
+	SYS_FALLOCATE,              /* Reserves disk space for a file. */
 };
 
 #endif /* lib/syscall-nr.h */
@@ -3,7 +3,10 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <dirent.h>
+#include <fcntl.h>
 #include <stddef.h>
+#include <stat.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -49,6 +52,15 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 int symlink (const char* target, const char* linkpath);
+int fsync (int fd);
+int fdatasync (int fd);
+void sync (void);
+int mount (const char *path, int chan_no, int dev_no);
+int umount (const char *path);
+int getdents (int fd, void *buffer, unsigned size);
+int stat (const char *path, struct stat *st);
+int fstat (int fd, struct stat *st);
+int fallocate (int fd, int mode, off_t offset, off_t len);
 
 static inline void* get_phys_addr (void *user_addr) {
 	void* pa;
@@ -1,15 +1,34 @@
 #ifndef VM_ANON_H
 #define VM_ANON_H
 #include "vm/vm.h"
+#include "devices/disk.h"
+#include "threads/vaddr.h"
+#include "filesys/off_t.h"
 struct page;
 enum vm_type;
+struct zswap_entry;
+struct inode;
 
 struct anon_page {
     struct segment_info *aux;
     int bitmap_index;
+    struct zswap_entry *zswap;  /* Compressed copy in zswap, if swapped there. */
+    struct inode *text_inode;   /* Executable a text page comes from, or null. */
+    off_t text_ofs;             /* Page offset in TEXT_INODE. */
+    size_t text_read_bytes;     /* Bytes from TEXT_INODE; the rest is zeros. */
 };
 
+/* Most anonymous pages whose swap writes are in flight at once: as many
+ * as one disk request can carry. */
+#define SWAP_BATCH (DISK_MAX_SECTORS * DISK_SECTOR_SIZE / PGSIZE)
+
 void vm_anon_init (void);
 bool anon_initializer (struct page *page, enum vm_type type, void *kva);
+bool anon_swap_copy (struct page *page, void *kva);
+void anon_swap_flush (void);
+bool anon_swap_write (struct page *page, const void *buf);
+void anon_set_text (struct page *page, struct inode *inode, off_t ofs,
+		size_t read_bytes);
+bool anon_drop_text (struct page *page);
 
 #endif
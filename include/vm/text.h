@@ -0,0 +1,17 @@
+#ifndef VM_TEXT_H
+#define VM_TEXT_H
+
+#include <stddef.h>
+#include "filesys/off_t.h"
+
+struct frame;
+struct inode;
+
+void text_init (void);
+
+struct frame *text_lookup (struct inode *, off_t ofs, size_t read_bytes);
+void text_insert (struct frame *, struct inode *, off_t ofs,
+		size_t read_bytes);
+void text_remove (struct frame *);
+
+#endif /* vm/text.h */
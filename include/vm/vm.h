@@ -21,6 +21,12 @@ enum vm_type {
 	VM_MARKER_0 = (1 << 3),
 	VM_MARKER_1 = (1 << 4),
 	VM_MARKER_STACK = (1 << 5),
+	/* The page starts out all zeros, so until it is first written it
+	 * can map the shared zero frame. */
+	VM_MARKER_ZERO = (1 << 6),
+	/* The page is read-only text of an executable, which processes
+	 * running the same file share through the text cache. */
+	VM_MARKER_TEXT = (1 << 7),
 
 	/* DO NOT EXCEED THIS VALUE. */
 	VM_MARKER_END = (1 << 31),
@@ -51,6 +57,8 @@ struct page {
 	//결국 페이지의 정보를 spt가 가지고 있을테니 spt에 이 struct page구조체가 들어가게 되니까 해쉬 정보를 가지고 있어야한다
 	struct hash_elem hash_elem;
 	bool write;
+	struct list_elem frame_elem;  /* Element in frame's PAGES list. */
+	struct thread *owner;         /* Thread whose spt holds this page. */
 
 	/* Per-type data are binded into the union.
 	 * Each function automatically detects the current union */
@@ -70,7 +78,14 @@ struct page {
 struct frame {
 	void *kva; // kernel va
 	struct page *page;
-	struct list_elem elem; // list로 사용하기 위함. page도 page table, pml4도 table이니까 frame도 table형태로!
+	struct thread *owner;  /* Owner of PAGE, whose pml4 maps this frame. */
+
+	/* Copy-on-write sharing after fork. */
+	struct list pages;     /* Every page mapping this frame. */
+	int ref_cnt;           /* Number of entries in PAGES. */
+
+	struct text_entry *text;  /* Entry in the text cache, if any. */
+	bool pinned;           /* Not to be chosen for eviction? */
 };
 
 /* The function table for page operations.
@@ -111,6 +126,11 @@ struct supplemental_page_table {
 };
 
 #include "threads/thread.h"
+#include "threads/synch.h"
+
+/* Protects the frame table and serializes eviction with page faults. */
+extern struct lock frame_lock;
+
 void supplemental_page_table_init (struct supplemental_page_table *spt);
 bool supplemental_page_table_copy (struct supplemental_page_table *dst,
 		struct supplemental_page_table *src);
@@ -131,6 +151,11 @@ bool vm_alloc_page_with_initializer (enum vm_type type, void *upage,
 void vm_dealloc_page (struct page *page);
 bool vm_claim_page (void *va);
 enum vm_type page_get_type (struct page *page);
+void vm_frame_link (struct frame *frame, struct page *page);
+int vm_frame_unlink (struct page *page);
+struct frame *vm_frame_of (void *kva);
+struct frame *vm_get_spare_frame (void);
+void vm_frame_free (struct frame *frame);
 
 void destroy_page_table (struct hash_elem *e, void *aux);
 static bool install_page_in_vm (void *upage, void *kpage, bool writable);
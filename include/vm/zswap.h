@@ -0,0 +1,17 @@
+#ifndef VM_ZSWAP_H
+#define VM_ZSWAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct page;
+
+void zswap_set_size (size_t kb);
+void zswap_init (void);
+
+bool zswap_store (struct page *, const void *kva);
+void zswap_load (struct page *, void *kva);
+void zswap_copy (struct page *, void *kva);
+void zswap_drop (struct page *);
+
+#endif /* vm/zswap.h */
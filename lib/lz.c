@@ -0,0 +1,182 @@
+#include "lz.h"
+#include <stdbool.h>
+#include <string.h>
+#include "debug.h"
+
+/* A small LZ77 compressor in the style of LZ4.
+
+   The compressed data is a series of sequences.  Each one starts
+   with a token byte whose high nibble is the number of literal
+   bytes that follow it and whose low nibble is the length of the
+   match after them, minus LZ_MIN_MATCH.  A nibble of 15 means
+   that the length continues in the following bytes, each adding
+   its value, up to a byte less than 255.  After the literals come
+   the match's offset back into the output, as 2 little-endian
+   bytes, and then the rest of the match length.  The last
+   sequence ends after its literals, with the input.
+
+   Matches are found through a hash table of the positions where
+   each 4-byte string was last seen, so compression is a single
+   greedy pass.  Runs such as zeroed memory come out as one long
+   overlapping match. */
+
+/* Shortest match worth encoding. */
+#define LZ_MIN_MATCH 4
+
+/* Largest match offset. */
+#define LZ_MAX_OFFSET 0xffff
+
+/* Reads 4 bytes at P, which need not be aligned. */
+static inline uint32_t
+read32 (const uint8_t *p) {
+	uint32_t v;
+	memcpy (&v, p, sizeof v);
+	return v;
+}
+
+/* Hashes the 4 bytes at P to an index into the position table. */
+static inline uint32_t
+hash4 (const uint8_t *p) {
+	return (read32 (p) * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* Writes the continuation bytes of length LEN, whose nibble in the
+   token was 15, at OP.  Returns the position after them. */
+static uint8_t *
+put_length (uint8_t *op, size_t len) {
+	if (len >= 15) {
+		for (len -= 15; len >= 255; len -= 255)
+			*op++ = 255;
+		*op++ = len;
+	}
+	return op;
+}
+
+/* Adds the continuation bytes at *IP, before IEND, to *LEN.
+   Returns false if the input ends first. */
+static bool
+get_length (const uint8_t **ip, const uint8_t *iend, size_t *len) {
+	uint8_t b;
+
+	do {
+		if (*ip >= iend)
+			return false;
+		b = *(*ip)++;
+		*len += b;
+	} while (b == 255);
+	return true;
+}
+
+/* Appends to *OP a sequence of LIT_LEN literals from LIT, followed,
+   if MATCH_LEN is nonzero, by a match of MATCH_LEN bytes OFFSET
+   bytes back.  Returns false if it does not fit before OEND. */
+static bool
+emit (uint8_t **op_, uint8_t *oend, const uint8_t *lit, size_t lit_len,
+		size_t offset, size_t match_len) {
+	uint8_t *op = *op_;
+	size_t ml = match_len > 0 ? match_len - LZ_MIN_MATCH : 0;
+	size_t need = 1 + lit_len / 255 + 1 + lit_len + 2 + ml / 255 + 1;
+
+	if ((size_t) (oend - op) < need)
+		return false;
+
+	*op++ = (lit_len < 15 ? lit_len : 15) << 4 | (ml < 15 ? ml : 15);
+	op = put_length (op, lit_len);
+	memcpy (op, lit, lit_len);
+	op += lit_len;
+	if (match_len > 0) {
+		*op++ = offset & 0xff;
+		*op++ = offset >> 8;
+		op = put_length (op, ml);
+	}
+	*op_ = op;
+	return true;
+}
+
+/* Compresses the SRC_LEN bytes at SRC, at most LZ_MAX_INPUT, into
+   the DST_CAP bytes at DST.  WORK must point to LZ_WORK_SIZE bytes
+   of scratch memory.  Returns the compressed size, or 0 if it
+   would exceed DST_CAP. */
+size_t
+lz_compress (const void *src_, size_t src_len, void *dst_, size_t dst_cap,
+		void *work) {
+	const uint8_t *src = src_;
+	const uint8_t *end = src + src_len;
+	const uint8_t *ip = src;
+	const uint8_t *anchor = src;
+	uint8_t *dst = dst_;
+	uint8_t *op = dst;
+	uint16_t *table = work;
+
+	ASSERT (src_len <= LZ_MAX_INPUT);
+	memset (table, 0, LZ_WORK_SIZE);
+
+	while (src_len >= LZ_MIN_MATCH && ip + LZ_MIN_MATCH <= end) {
+		uint32_t h = hash4 (ip);
+		const uint8_t *ref = src + table[h];
+
+		table[h] = ip - src;
+		if (ref < ip && ip - ref <= LZ_MAX_OFFSET
+				&& read32 (ref) == read32 (ip)) {
+			size_t len = LZ_MIN_MATCH;
+
+			while (ip + len < end && ref[len] == ip[len])
+				len++;
+			if (!emit (&op, dst + dst_cap, anchor, ip - anchor, ip - ref, len))
+				return 0;
+			ip += len;
+			anchor = ip;
+		} else
+			ip++;
+	}
+
+	if (!emit (&op, dst + dst_cap, anchor, end - anchor, 0, 0))
+		return 0;
+	return op - dst;
+}
+
+/* Decompresses the SRC_LEN bytes at SRC into the DST_CAP bytes at
+   DST.  Returns the decompressed size, or 0 if SRC is malformed or
+   does not fit. */
+size_t
+lz_decompress (const void *src_, size_t src_len, void *dst_, size_t dst_cap) {
+	const uint8_t *ip = src_;
+	const uint8_t *iend = ip + src_len;
+	uint8_t *dst = dst_;
+	uint8_t *op = dst;
+	uint8_t *oend = dst + dst_cap;
+
+	while (ip < iend) {
+		unsigned token = *ip++;
+		size_t lit_len = token >> 4;
+		size_t match_len = token & 15;
+		size_t offset;
+		const uint8_t *ref;
+
+		if (lit_len == 15 && !get_length (&ip, iend, &lit_len))
+			return 0;
+		if (lit_len > (size_t) (iend - ip) || lit_len > (size_t) (oend - op))
+			return 0;
+		memcpy (op, ip, lit_len);
+		op += lit_len;
+		ip += lit_len;
+		if (ip == iend)
+			break;
+
+		if (iend - ip < 2)
+			return 0;
+		offset = ip[0] | ip[1] << 8;
+		ip += 2;
+		if (match_len == 15 && !get_length (&ip, iend, &match_len))
+			return 0;
+		match_len += LZ_MIN_MATCH;
+		if (offset == 0 || offset > (size_t) (op - dst)
+				|| match_len > (size_t) (oend - op))
+			return 0;
+
+		/* Byte by byte, since the match may overlap its own output. */
+		for (ref = op - offset; match_len > 0; match_len--)
+			*op++ = *ref++;
+	}
+	return op - dst;
+}
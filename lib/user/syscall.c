@@ -54,7 +54,7 @@ static __inline int64_t syscall (uint64_t num_, uint64_t a1_, uint64_t a2_,
 			((uint64_t) ARG2), 0, 0, 0))
 
 #define syscall4(NUMBER, ARG0, ARG1, ARG2, ARG3) ( \
-		syscall(((uint64_t *) NUMBER), \
+		syscall(((uint64_t) NUMBER), \
 			((uint64_t) ARG0), \
 			((uint64_t) ARG1), \
 			((uint64_t) ARG2), \
@@ -185,6 +185,21 @@ symlink (const char* target, const char* linkpath) {
 	return syscall2 (SYS_SYMLINK, target, linkpath);
 }
 
+int
+fsync (int fd) {
+	return syscall1 (SYS_FSYNC, fd);
+}
+
+int
+fdatasync (int fd) {
+	return syscall1 (SYS_FDATASYNC, fd);
+}
+
+void
+sync (void) {
+	syscall0 (SYS_SYNC);
+}
+
 int
 mount (const char *path, int chan_no, int dev_no) {
 	return syscall3 (SYS_MOUNT, path, chan_no, dev_no);
@@ -194,3 +209,23 @@ int
 umount (const char *path) {
 	return syscall1 (SYS_UMOUNT, path);
 }
+
+int
+getdents (int fd, void *buffer, unsigned size) {
+	return syscall3 (SYS_GETDENTS, fd, buffer, size);
+}
+
+int
+stat (const char *path, struct stat *st) {
+	return syscall2 (SYS_STAT, path, st);
+}
+
+int
+fstat (int fd, struct stat *st) {
+	return syscall2 (SYS_FSTAT, fd, st);
+}
+
+int
+fallocate (int fd, int mode, off_t offset, off_t len) {
+	return syscall4 (SYS_FALLOCATE, fd, mode, offset, len);
+}
@@ -0,0 +1,70 @@
+/* Reserves space for a file with fallocate(), growing it and then
+   reserving past its end with FALLOC_FL_KEEP_SIZE, and checks that
+   writing the reserved range later allocates nothing more. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define GROW_SIZE 20000
+#define KEEP_SIZE 10000
+
+static char buf[GROW_SIZE + KEEP_SIZE];
+
+/* Returns the clusters of the file open as FD, checking that it is
+   SIZE bytes long. */
+static uint32_t
+check_size (int fd, size_t size)
+{
+  struct stat st;
+
+  CHECK (fstat (fd, &st) == 0, "fstat \"a\"");
+  if (st.st_size != size)
+    fail ("\"a\" is %u bytes long, not %zu", st.st_size, size);
+  return st.st_blocks;
+}
+
+void
+test_main (void) 
+{
+  uint32_t blocks, more_blocks;
+  int fd, dir_fd;
+
+  random_init (0);
+  random_bytes (buf + GROW_SIZE, KEEP_SIZE);
+
+  CHECK (create ("a", 0), "create \"a\"");
+  CHECK ((fd = open ("a")) > 1, "open \"a\"");
+  CHECK (fallocate (fd, 0, 0, GROW_SIZE) == 0,
+         "fallocate %d bytes of \"a\"", GROW_SIZE);
+  blocks = check_size (fd, GROW_SIZE);
+  CHECK (blocks > 0, "\"a\" has clusters");
+
+  CHECK (fallocate (fd, FALLOC_FL_KEEP_SIZE, GROW_SIZE, KEEP_SIZE) == 0,
+         "fallocate %d bytes past the end of \"a\"", KEEP_SIZE);
+  more_blocks = check_size (fd, GROW_SIZE);
+  CHECK (more_blocks > blocks, "\"a\" has more clusters");
+
+  msg ("seek \"a\"");
+  seek (fd, GROW_SIZE);
+  CHECK (write (fd, buf + GROW_SIZE, KEEP_SIZE) == KEEP_SIZE,
+         "write the reserved bytes of \"a\"");
+  CHECK (check_size (fd, sizeof buf) == more_blocks,
+         "\"a\" has no new clusters");
+
+  CHECK (fallocate (fd, 0, 0, 0) == -1, "fallocate 0 bytes (must fail)");
+  CHECK (fallocate (fd, 0x100, 0, 1) == -1,
+         "fallocate with a bad mode (must fail)");
+  msg ("close \"a\"");
+  close (fd);
+  CHECK (fallocate (fd, 0, 0, 1) == -1, "fallocate closed fd (must fail)");
+
+  CHECK ((dir_fd = open (".")) > 1, "open \".\"");
+  CHECK (fallocate (dir_fd, 0, 0, 1) == -1,
+         "fallocate a directory (must fail)");
+  msg ("close \".\"");
+  close (dir_fd);
+
+  check_file ("a", buf, sizeof buf);
+}
@@ -0,0 +1,31 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(fallocate-file) begin
+(fallocate-file) create "a"
+(fallocate-file) open "a"
+(fallocate-file) fallocate 20000 bytes of "a"
+(fallocate-file) fstat "a"
+(fallocate-file) "a" has clusters
+(fallocate-file) fallocate 10000 bytes past the end of "a"
+(fallocate-file) fstat "a"
+(fallocate-file) "a" has more clusters
+(fallocate-file) seek "a"
+(fallocate-file) write the reserved bytes of "a"
+(fallocate-file) fstat "a"
+(fallocate-file) "a" has no new clusters
+(fallocate-file) fallocate 0 bytes (must fail)
+(fallocate-file) fallocate with a bad mode (must fail)
+(fallocate-file) close "a"
+(fallocate-file) fallocate closed fd (must fail)
+(fallocate-file) open "."
+(fallocate-file) fallocate a directory (must fail)
+(fallocate-file) close "."
+(fallocate-file) open "a" for verification
+(fallocate-file) verified contents of "a"
+(fallocate-file) close "a"
+(fallocate-file) end
+EOF
+pass;
@@ -0,0 +1,33 @@
+/* Writes a file and forces it to disk with fsync() and
+   fdatasync(), which must then fail once the file is closed. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[10240];
+
+void
+test_main (void) 
+{
+  const char *file_name = "data";
+  int fd;
+
+  random_init (0);
+  random_bytes (buf, sizeof buf);
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK (write (fd, buf, sizeof buf / 2) == sizeof buf / 2,
+         "write first half of \"%s\"", file_name);
+  CHECK (fsync (fd) == 0, "fsync \"%s\"", file_name);
+  CHECK (write (fd, buf + sizeof buf / 2, sizeof buf / 2) == sizeof buf / 2,
+         "write second half of \"%s\"", file_name);
+  CHECK (fdatasync (fd) == 0, "fdatasync \"%s\"", file_name);
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  CHECK (fsync (fd) == -1, "fsync closed fd (must fail)");
+  CHECK (fdatasync (fd) == -1, "fdatasync closed fd (must fail)");
+  check_file (file_name, buf, sizeof buf);
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(fsync-file) begin
+(fsync-file) create "data"
+(fsync-file) open "data"
+(fsync-file) write first half of "data"
+(fsync-file) fsync "data"
+(fsync-file) write second half of "data"
+(fsync-file) fdatasync "data"
+(fsync-file) close "data"
+(fsync-file) fsync closed fd (must fail)
+(fsync-file) fdatasync closed fd (must fail)
+(fsync-file) open "data" for verification
+(fsync-file) verified contents of "data"
+(fsync-file) close "data"
+(fsync-file) end
+EOF
+pass;
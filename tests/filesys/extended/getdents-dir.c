@@ -0,0 +1,100 @@
+/* Lists a directory holding a file, a subdirectory and a symbolic
+   link with getdents(), into a buffer with room for only one entry
+   at a time, and checks the name, type and inode number reported
+   for each. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+struct entry
+  {
+    const char *name;           /* File name in "d". */
+    uint8_t type;               /* Expected D_TYPE. */
+    int ino;                    /* Expected D_INO, 0 to skip. */
+    bool seen;                  /* Listed yet? */
+  };
+
+static struct entry entries[] =
+  {
+    {"file", DT_REG, 0, false},
+    {"sub", DT_DIR, 0, false},
+    {"link", DT_LNK, 0, false},
+  };
+
+#define ENTRY_CNT (sizeof entries / sizeof *entries)
+
+/* Room for one entry with a name of up to 15 bytes. */
+static uint32_t buf[6];
+
+static int
+get_inumber (const char *file_name)
+{
+  int fd, ino;
+
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  ino = inumber (fd);
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  return ino;
+}
+
+static void
+check_dirent (const struct dirent *d)
+{
+  size_t i;
+
+  for (i = 0; i < ENTRY_CNT; i++)
+    if (!strcmp (d->d_name, entries[i].name))
+      break;
+  if (i == ENTRY_CNT)
+    fail ("unexpected entry \"%s\"", d->d_name);
+  if (entries[i].seen)
+    fail ("\"%s\" listed twice", d->d_name);
+  if (d->d_type != entries[i].type)
+    fail ("\"%s\" has type %d, not %d",
+          d->d_name, d->d_type, entries[i].type);
+  if (entries[i].ino != 0 && (int) d->d_ino != entries[i].ino)
+    fail ("\"%s\" has inode number %d, not %d",
+          d->d_name, (int) d->d_ino, entries[i].ino);
+  entries[i].seen = true;
+}
+
+void
+test_main (void) 
+{
+  int dir_fd, fd, cnt, ofs;
+  size_t i;
+
+  CHECK (mkdir ("d"), "mkdir \"d\"");
+  CHECK (create ("d/file", 0), "create \"d/file\"");
+  CHECK (mkdir ("d/sub"), "mkdir \"d/sub\"");
+  CHECK (symlink ("/d/file", "d/link") == 0, "create symlink \"d/link\"");
+  entries[0].ino = get_inumber ("d/file");
+  entries[1].ino = get_inumber ("d/sub");
+
+  CHECK ((dir_fd = open ("d")) > 1, "open \"d\"");
+  CHECK (getdents (dir_fd, buf, 4) == -1,
+         "getdents \"d\" into 4 bytes (must fail)");
+  msg ("getdents \"d\"");
+  while ((cnt = getdents (dir_fd, buf, sizeof buf)) > 0)
+    for (ofs = 0; ofs < cnt; )
+      {
+        const struct dirent *d = (const struct dirent *) ((char *) buf + ofs);
+        check_dirent (d);
+        ofs += d->d_reclen;
+      }
+  if (cnt < 0)
+    fail ("getdents \"d\" returned %d", cnt);
+  for (i = 0; i < ENTRY_CNT; i++)
+    CHECK (entries[i].seen, "found \"%s\"", entries[i].name);
+  msg ("close \"d\"");
+  close (dir_fd);
+
+  CHECK ((fd = open ("d/file")) > 1, "open \"d/file\"");
+  CHECK (getdents (fd, buf, sizeof buf) == -1,
+         "getdents \"d/file\" (must fail)");
+  msg ("close \"d/file\"");
+  close (fd);
+}
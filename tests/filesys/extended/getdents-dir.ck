@@ -0,0 +1,27 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(getdents-dir) begin
+(getdents-dir) mkdir "d"
+(getdents-dir) create "d/file"
+(getdents-dir) mkdir "d/sub"
+(getdents-dir) create symlink "d/link"
+(getdents-dir) open "d/file"
+(getdents-dir) close "d/file"
+(getdents-dir) open "d/sub"
+(getdents-dir) close "d/sub"
+(getdents-dir) open "d"
+(getdents-dir) getdents "d" into 4 bytes (must fail)
+(getdents-dir) getdents "d"
+(getdents-dir) found "file"
+(getdents-dir) found "sub"
+(getdents-dir) found "link"
+(getdents-dir) close "d"
+(getdents-dir) open "d/file"
+(getdents-dir) getdents "d/file" (must fail)
+(getdents-dir) close "d/file"
+(getdents-dir) end
+EOF
+pass;
@@ -0,0 +1,45 @@
+/* Mounts disk hd2:0, formatted before the test, on a directory,
+   writes a file to it and unmounts it, which must write the file to
+   that disk: after mounting the disk again, the file is read back
+   from it.  Also checks that the boot and scratch disks cannot be
+   mounted, that a disk cannot be mounted twice, and that it cannot
+   be unmounted while one of its files is open. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[8000];
+
+void
+test_main (void) 
+{
+  const char *file_name = "mnt/data";
+  int fd;
+
+  random_init (0);
+  random_bytes (buf, sizeof buf);
+
+  CHECK (mkdir ("mnt"), "mkdir \"mnt\"");
+  CHECK (mount ("mnt", 0, 0) == -1, "mount boot disk hd0:0 (must fail)");
+  CHECK (mount ("mnt", 1, 0) == -1, "mount scratch disk hd1:0 (must fail)");
+  CHECK (mount ("mnt", 2, 0) == 0, "mount hd2:0 on \"mnt\"");
+  CHECK (mount ("mnt", 2, 0) == -1, "mount hd2:0 again (must fail)");
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK (write (fd, buf, sizeof buf) == sizeof buf,
+         "write \"%s\"", file_name);
+  CHECK (umount ("mnt") == -1, "umount \"mnt\" with a file open (must fail)");
+  msg ("close \"%s\"", file_name);
+  close (fd);
+
+  CHECK (umount ("mnt") == 0, "umount \"mnt\"");
+  CHECK (open (file_name) == -1, "open \"%s\" (must fail)", file_name);
+  CHECK (umount ("mnt") == -1, "umount \"mnt\" again (must fail)");
+
+  CHECK (mount ("mnt", 2, 0) == 0, "mount hd2:0 on \"mnt\" again");
+  check_file (file_name, buf, sizeof buf);
+  CHECK (umount ("mnt") == 0, "umount \"mnt\"");
+}
@@ -0,0 +1,27 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mount-umount) begin
+(mount-umount) mkdir "mnt"
+(mount-umount) mount boot disk hd0:0 (must fail)
+(mount-umount) mount scratch disk hd1:0 (must fail)
+(mount-umount) mount hd2:0 on "mnt"
+(mount-umount) mount hd2:0 again (must fail)
+(mount-umount) create "mnt/data"
+(mount-umount) open "mnt/data"
+(mount-umount) write "mnt/data"
+(mount-umount) umount "mnt" with a file open (must fail)
+(mount-umount) close "mnt/data"
+(mount-umount) umount "mnt"
+(mount-umount) open "mnt/data" (must fail)
+(mount-umount) umount "mnt" again (must fail)
+(mount-umount) mount hd2:0 on "mnt" again
+(mount-umount) open "mnt/data" for verification
+(mount-umount) verified contents of "mnt/data"
+(mount-umount) close "mnt/data"
+(mount-umount) umount "mnt"
+(mount-umount) end
+EOF
+pass;
@@ -0,0 +1,8 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+my ($f) = random_bytes (5000);
+check_archive ({"f" => [$f], "d" => {}, "l" => [$f]});
+pass;
@@ -0,0 +1,47 @@
+/* Checks what stat() and fstat() report for a file, a directory and
+   a symbolic link, and that both fail on files that do not exist or
+   are not open. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[5000];
+
+void
+test_main (void) 
+{
+  struct stat st, fst;
+  int fd;
+
+  random_init (0);
+  random_bytes (buf, sizeof buf);
+
+  CHECK (create ("f", 0), "create \"f\"");
+  CHECK ((fd = open ("f")) > 1, "open \"f\"");
+  CHECK (write (fd, buf, sizeof buf) == sizeof buf, "write \"f\"");
+  CHECK (fstat (fd, &fst) == 0, "fstat \"f\"");
+  CHECK (fst.st_type == DT_REG, "\"f\" is a regular file");
+  CHECK (fst.st_size == sizeof buf, "\"f\" is %zu bytes long", sizeof buf);
+  CHECK (fst.st_blocks > 0, "\"f\" has clusters");
+  CHECK ((int) fst.st_ino == inumber (fd), "fstat matches inumber");
+  CHECK (stat ("f", &st) == 0, "stat \"f\"");
+  CHECK (st.st_ino == fst.st_ino && st.st_size == fst.st_size
+         && st.st_blocks == fst.st_blocks && st.st_type == fst.st_type,
+         "stat matches fstat");
+  msg ("close \"f\"");
+  close (fd);
+  CHECK (fstat (fd, &fst) == -1, "fstat closed fd (must fail)");
+
+  CHECK (mkdir ("d"), "mkdir \"d\"");
+  CHECK (stat ("d", &st) == 0, "stat \"d\"");
+  CHECK (st.st_type == DT_DIR, "\"d\" is a directory");
+
+  CHECK (symlink ("/f", "l") == 0, "create symlink \"l\"");
+  CHECK (stat ("l", &st) == 0, "stat \"l\"");
+  CHECK (st.st_type == DT_LNK, "\"l\" is a symbolic link");
+  CHECK (st.st_ino != fst.st_ino, "\"l\" is not \"f\"");
+
+  CHECK (stat ("missing", &st) == -1, "stat \"missing\" (must fail)");
+}
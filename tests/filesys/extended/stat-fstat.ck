@@ -0,0 +1,29 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(stat-fstat) begin
+(stat-fstat) create "f"
+(stat-fstat) open "f"
+(stat-fstat) write "f"
+(stat-fstat) fstat "f"
+(stat-fstat) "f" is a regular file
+(stat-fstat) "f" is 5000 bytes long
+(stat-fstat) "f" has clusters
+(stat-fstat) fstat matches inumber
+(stat-fstat) stat "f"
+(stat-fstat) stat matches fstat
+(stat-fstat) close "f"
+(stat-fstat) fstat closed fd (must fail)
+(stat-fstat) mkdir "d"
+(stat-fstat) stat "d"
+(stat-fstat) "d" is a directory
+(stat-fstat) create symlink "l"
+(stat-fstat) stat "l"
+(stat-fstat) "l" is a symbolic link
+(stat-fstat) "l" is not "f"
+(stat-fstat) stat "missing" (must fail)
+(stat-fstat) end
+EOF
+pass;
@@ -0,0 +1,9 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+my ($a) = random_bytes (6000);
+my ($b) = random_bytes (3000);
+check_archive ({"d" => {"a" => [$a]}, "b" => [$b]});
+pass;
@@ -0,0 +1,44 @@
+/* Creates, grows and removes files in two directories, writing
+   everything to disk with sync() after each step. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf_a[6000];
+static char buf_b[3000];
+
+static void
+write_file (const char *file_name, const void *buf, size_t size)
+{
+  int fd;
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK (write (fd, buf, size) == (int) size, "write \"%s\"", file_name);
+  msg ("close \"%s\"", file_name);
+  close (fd);
+}
+
+void
+test_main (void) 
+{
+  random_init (0);
+  random_bytes (buf_a, sizeof buf_a);
+  random_bytes (buf_b, sizeof buf_b);
+
+  CHECK (mkdir ("d"), "mkdir \"d\"");
+  write_file ("d/a", buf_a, sizeof buf_a);
+  write_file ("b", buf_b, sizeof buf_b);
+  write_file ("gone", buf_b, sizeof buf_b);
+  msg ("sync");
+  sync ();
+
+  CHECK (remove ("gone"), "remove \"gone\"");
+  msg ("sync");
+  sync ();
+
+  check_file ("d/a", buf_a, sizeof buf_a);
+  check_file ("b", buf_b, sizeof buf_b);
+}
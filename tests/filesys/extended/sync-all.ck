@@ -0,0 +1,31 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(sync-all) begin
+(sync-all) mkdir "d"
+(sync-all) create "d/a"
+(sync-all) open "d/a"
+(sync-all) write "d/a"
+(sync-all) close "d/a"
+(sync-all) create "b"
+(sync-all) open "b"
+(sync-all) write "b"
+(sync-all) close "b"
+(sync-all) create "gone"
+(sync-all) open "gone"
+(sync-all) write "gone"
+(sync-all) close "gone"
+(sync-all) sync
+(sync-all) remove "gone"
+(sync-all) sync
+(sync-all) open "d/a" for verification
+(sync-all) verified contents of "d/a"
+(sync-all) close "d/a"
+(sync-all) open "b" for verification
+(sync-all) verified contents of "b"
+(sync-all) close "b"
+(sync-all) end
+EOF
+pass;
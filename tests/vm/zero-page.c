@@ -0,0 +1,36 @@
+/* Reads two untouched bss pages, so that both may map the same
+   zero page, then read()s a file into one of them.  The kernel's
+   write must not show through the other page. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char zeros[3][4096] __attribute__ ((aligned (4096)));
+
+void
+test_main (void)
+{
+  char *buf = zeros[1];
+  char *other = zeros[2];
+  size_t len = strlen (sample);
+  int handle;
+  size_t i;
+
+  if (buf[0] != 0 || other[0] != 0)
+    fail ("untouched bss is not zero");
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  if (read (handle, buf, len) != (int) len)
+    fail ("read of \"sample.txt\" failed");
+  close (handle);
+
+  if (memcmp (buf, sample, len))
+    fail ("read into bss reported bad data");
+  for (i = 0; i < sizeof zeros[2]; i++)
+    if (other[i] != 0)
+      fail ("byte %zu of other bss page has value %02hhx (should be 0)",
+            i, other[i]);
+}
@@ -31,9 +31,12 @@
 #include "tests/threads/tests.h"
 #ifdef VM
 #include "vm/vm.h"
+#include "vm/zswap.h"
 #endif
 #ifdef FILESYS
 #include "devices/disk.h"
+#include "devices/ramdisk.h"
+#include "filesys/fat.h"
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
 #endif
@@ -217,6 +220,34 @@ parse_options (char **argv) {
 #ifdef FILESYS
 		else if (!strcmp (name, "-f"))
 			format_filesys = true;
+		else if (!strcmp (name, "-iosched")) {
+			if (value == NULL || !disk_set_iosched (value))
+				PANIC ("unknown I/O scheduler `%s' (use -h for help)", value);
+		}
+		else if (!strcmp (name, "-cluster")) {
+			if (value == NULL || !fat_set_cluster_size (atoi (value)))
+				PANIC ("bad cluster size `%s' (use -h for help)", value);
+		}
+		else if (!strcmp (name, "-ramdisk")) {
+			if (value == NULL || atoi (value) <= 0)
+				PANIC ("bad RAM disk size `%s' (use -h for help)", value);
+			ramdisk_set_size (atoi (value));
+		}
+		else if (!strcmp (name, "-filesys-disk")) {
+			if (!disk_set_role (DISK_FILESYS, value))
+				PANIC ("bad disk name `%s' (use -h for help)", value);
+		}
+		else if (!strcmp (name, "-swap-disk")) {
+			if (!disk_set_role (DISK_SWAP, value))
+				PANIC ("bad disk name `%s' (use -h for help)", value);
+		}
+#endif
+#ifdef VM
+		else if (!strcmp (name, "-zswap")) {
+			if (value == NULL || atoi (value) <= 0)
+				PANIC ("bad zswap size `%s' (use -h for help)", value);
+			zswap_set_size (atoi (value));
+		}
 #endif
 		else if (!strcmp (name, "-rs"))
 			random_init (atoi (value));
@@ -271,6 +302,7 @@ run_actions (char **argv) {
 		{"ls", 1, fsutil_ls},
 		{"cat", 2, fsutil_cat},
 		{"rm", 2, fsutil_rm},
+		{"mkfs", 2, fsutil_mkfs},
 		{"put", 2, fsutil_put},
 		{"get", 2, fsutil_get},
 #endif
@@ -317,6 +349,7 @@ usage (void) {
 			"  ls                 List files in the root directory.\n"
 			"  cat FILE           Print FILE to the console.\n"
 			"  rm FILE            Delete FILE.\n"
+			"  mkfs DISK          Format DISK (e.g. hd2:0) for mounting.\n"
 			"Use these actions indirectly via `pintos' -g and -p options:\n"
 			"  put FILE           Put FILE into file system from scratch disk.\n"
 			"  get FILE           Get FILE from file system into scratch disk.\n"
@@ -325,6 +358,18 @@ usage (void) {
 			"  -h                 Print this help message and power off.\n"
 			"  -q                 Power off VM after actions or on panic.\n"
 			"  -f                 Format file system disk during startup.\n"
+#ifdef FILESYS
+			"  -iosched=NAME      Schedule disk I/O with NAME: noop, clook or\n"
+			"                     deadline (default).\n"
+			"  -cluster=N         Format with N-sector clusters, 1 to 64 (default 1).\n"
+			"  -ramdisk=KB        Create a KB kB RAM disk as hd2:0.\n"
+			"  -filesys-disk=C:D  Use disk hdC:D for the file system (default 0:1).\n"
+			"  -swap-disk=C:D     Use disk hdC:D for swap (default 1:1).\n"
+#endif
+#ifdef VM
+			"  -zswap=KB          Keep up to KB kB of compressed swapped-out\n"
+			"                     pages in memory (default off).\n"
+#endif
 			"  -rs=SEED           Set random number seed to SEED.\n"
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
 #ifdef USERPROG
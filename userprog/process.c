@@ -1090,7 +1090,15 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 		load_info->zero_bytes = page_zero_bytes;
 		//vm_alloc_page 함수를 호출해서 페이지를 생성해주는거다
 		//여기서 5번째 인자인 aux가 페이지에 로드할 내용이고 4번째 인자인 lazy_load_segment가 이 내용물을 넣어주는 함수이다
-		if (!vm_alloc_page_with_initializer (VM_ANON, upage,
+		/* Pure bss pages can start on the shared zero frame, and
+		 * read-only pages are shared with other processes running
+		 * the same file. */
+		enum vm_type type = VM_ANON;
+		if (page_read_bytes == 0)
+			type |= VM_MARKER_ZERO;
+		else if (!writable)
+			type |= VM_MARKER_TEXT;
+		if (!vm_alloc_page_with_initializer (type, upage,
 					writable, lazy_load_segment, load_info))
 			//이 과정에서 lazy_load_segment을 호출한뒤 반환값을 vm_alloc의 인자로 넣는다
 			return false;
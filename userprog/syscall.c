@@ -3,6 +3,8 @@
 #include <syscall-nr.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <stat.h>
 #include "threads/synch.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
@@ -53,6 +55,14 @@ bool readdir (int fd, char *name);
 bool isdir (int fd);
 int inumber (int fd);
 int symlink (const char *target, const char *linkpath);
+int fsync (int fd, bool datasync);
+void sync (void);
+int mount (const char *path, int chan_no, int dev_no);
+int umount (const char *path);
+int getdents (int fd, void *buffer, unsigned size);
+int stat (const char *path, struct stat *st);
+int fstat (int fd, struct stat *st);
+int fallocate (int fd, int mode, off_t offset, off_t len);
 
 /* System call.
  *
@@ -179,6 +189,33 @@ syscall_handler (struct intr_frame *f UNUSED) {
 		case (SYS_SYMLINK):
 			f->R.rax = symlink((const char *) f->R.rdi, (const char *) f->R.rsi);
 			break;
+		case (SYS_FSYNC):
+			f->R.rax = fsync((int) f->R.rdi, false);
+			break;
+		case (SYS_FDATASYNC):
+			f->R.rax = fsync((int) f->R.rdi, true);
+			break;
+		case (SYS_SYNC):
+			sync();
+			break;
+		case (SYS_MOUNT):
+			f->R.rax = mount((const char *) f->R.rdi, (int) f->R.rsi, (int) f->R.rdx);
+			break;
+		case (SYS_UMOUNT):
+			f->R.rax = umount((const char *) f->R.rdi);
+			break;
+		case (SYS_GETDENTS):
+			f->R.rax = getdents((int) f->R.rdi, (void *) f->R.rsi, (unsigned) f->R.rdx);
+			break;
+		case (SYS_STAT):
+			f->R.rax = stat((const char *) f->R.rdi, (struct stat *) f->R.rsi);
+			break;
+		case (SYS_FSTAT):
+			f->R.rax = fstat((int) f->R.rdi, (struct stat *) f->R.rsi);
+			break;
+		case (SYS_FALLOCATE):
+			f->R.rax = fallocate((int) f->R.rdi, (int) f->R.rsi, (off_t) f->R.rdx, (off_t) f->R.r10);
+			break;
 		default:
 			printf ("system call!\n");
 			thread_exit ();
@@ -927,18 +964,24 @@ bool mkdir (const char *dir) {
 	// printf("(mkdir) inode가 null인가? %s\n", inode == NULL? "true":"false");
 
 
-	// 새로운 chain을 만들어서 inode sector 번호를 받아야 함
-	cluster_t inode_sector_num = fat_create_chain(0);
 	// dir이 NULL이면 당연히 error
+	cluster_t inode_sector_num = 0;
+	struct fs *fs = NULL;
 	if (real_dir == NULL) { goto error; }
+
+	// 새로운 chain을 만들어서 inode sector 번호를 받아야 함
+	/* The new directory goes on the file system of its parent. */
+	fs = inode_get_fs(dir_get_inode(real_dir));
+	inode_sector_num = fat_create_chain(fs, 0);
+	if (inode_sector_num == 0) { goto error; }
 	
 	// 이렇게 만들어진 sector에 위에서 받은 file_name의 dir을 만들어야 함. 안 만들어지면 당연히 error
 	// bool create_dir = dir_create(inode_sector_num, 16);
-	bool create_dir = dir_create(cluster_to_sector(inode_sector_num), 0);
+	bool create_dir = dir_create(fs, cluster_to_sector(fs, inode_sector_num), 0);
 	if (!create_dir) { goto error; }
 
 	// dir에 file_name entry를 추가해줘야 함. 잘 안되면 당연히 goto error
-	bool add_file_name = dir_add(real_dir, file_name, cluster_to_sector(inode_sector_num));
+	bool add_file_name = dir_add(real_dir, file_name, cluster_to_sector(fs, inode_sector_num));
 	if (!add_file_name) { goto error; }
 
 	/*
@@ -952,9 +995,9 @@ bool mkdir (const char *dir) {
 	
 	// gitbook에 적힌 대로, Unix의 특수 파일 이름을 나타내는 "."랑 ".."도 넣어줘야함
 	//struct dir *check_dir = dir_open(check_inode);
-	struct dir *check_dir = dir_open(inode_open(cluster_to_sector(inode_sector_num)));
+	struct dir *check_dir = dir_open(inode_open(fs, cluster_to_sector(fs, inode_sector_num)));
 	// printf("(mkdir) real dir: 0x%x, check_dir: 0x%x\n", real_dir, check_dir);
-	bool add_dot = dir_add(check_dir, ".", cluster_to_sector(inode_sector_num));
+	bool add_dot = dir_add(check_dir, ".", cluster_to_sector(fs, inode_sector_num));
 	bool add_dot_dot = dir_add(check_dir, "..", inode_get_inumber(dir_get_inode(real_dir)));
 	if (!(add_dot && add_dot_dot)) {
 		dir_close(check_dir);
@@ -970,7 +1013,7 @@ bool mkdir (const char *dir) {
 	return true;
 error:
 	if (inode_sector_num != 0) {
-		fat_remove_chain(inode_sector_num, 0);
+		fat_remove_chain(fs, inode_sector_num, 0);
 	}
 	dir_close(real_dir);
 	free(copy_dir);
@@ -1013,6 +1056,93 @@ bool readdir (int fd, char *name) {
 	}
 }
 
+/* Fills BUFFER, SIZE bytes long, with as many entries of the
+   directory open as FD as fit, packed as struct dirents, starting
+   from FD's position, which it then advances past them.  Returns the
+   number of bytes filled, 0 at the end of the directory, or -1 if FD
+   is not a directory or SIZE is too small for the next entry. */
+int getdents (int fd, void *buffer, unsigned size) {
+	if (size == 0)
+		return -1;
+	check_address(buffer);
+	check_address((uint8_t *) buffer + size - 1);
+
+	struct fd_structure *fd_elem = find_by_fd_index(fd);
+	if (fd_elem == NULL || fd_elem->current_file == NULL)
+		return -1;
+
+	struct file *file = fd_elem->current_file;
+	struct inode *inode = file_get_inode(file);
+	if (!inode_is_directory(inode))
+		return -1;
+
+	lock_acquire(&file_lock);
+	off_t pos = file_tell(file);
+	int result = dir_getdents(inode, &pos, buffer, size);
+	file_seek(file, pos);
+	lock_release(&file_lock);
+	return result;
+}
+
+/* Fills ST with the length, type, inode number and cluster count
+   of the file PATH names.  A symbolic link at the end of PATH is
+   described itself, not followed.  Returns 0 on success, -1 if there
+   is no such file. */
+int stat (const char *path, struct stat *st) {
+	check_address(path);
+	check_address(st);
+	check_address((uint8_t *) (st + 1) - 1);
+
+	/* Opening and closing the inode changes the open inode list, as
+	   open() and remove() do. */
+	lock_acquire(&file_lock);
+	struct inode *inode = filesys_lookup(path);
+	if (inode != NULL) {
+		inode_stat(inode, st);
+		inode_close(inode);
+	}
+	lock_release(&file_lock);
+	return inode != NULL ? 0 : -1;
+}
+
+/* Like stat(), for the file open as FD.  Returns -1 if FD is not
+   open. */
+int fstat (int fd, struct stat *st) {
+	check_address(st);
+	check_address((uint8_t *) (st + 1) - 1);
+
+	struct fd_structure *fd_elem = find_by_fd_index(fd);
+	if (fd_elem == NULL || fd_elem->current_file == NULL)
+		return -1;
+	lock_acquire(&file_lock);
+	inode_stat(file_get_inode(fd_elem->current_file), st);
+	lock_release(&file_lock);
+	return 0;
+}
+
+/* Reserves disk space for bytes OFFSET through OFFSET + LEN - 1 of
+   the file open as FD, as one contiguous run where possible, so that
+   writing them later is sequential on disk and allocates nothing.
+   The file grows to cover the range unless MODE has
+   FALLOC_FL_KEEP_SIZE.  Returns 0 on success, -1 if FD is not a
+   writable regular file, the range is invalid or the disk is full. */
+int fallocate (int fd, int mode, off_t offset, off_t len) {
+	if (offset < 0 || len <= 0 || offset + len < offset
+			|| (mode & ~FALLOC_FL_KEEP_SIZE) != 0)
+		return -1;
+
+	struct fd_structure *fd_elem = find_by_fd_index(fd);
+	if (fd_elem == NULL || fd_elem->current_file == NULL
+			|| is_file_dir(fd_elem->current_file))
+		return -1;
+
+	lock_acquire(&file_lock);
+	bool success = inode_allocate(file_get_inode(fd_elem->current_file),
+			offset, len, (mode & FALLOC_FL_KEEP_SIZE) != 0);
+	lock_release(&file_lock);
+	return success ? 0 : -1;
+}
+
 bool isdir (int fd) {
 	/* fd가 directory를 나타내면 true, 그냥 file을 나타내면 false */
 	struct fd_structure* fd_elem = find_by_fd_index(fd);
@@ -1046,6 +1176,49 @@ int inumber (int fd) {
 	}
 }
 
+/* Forces the file open as FD to disk, including its inode unless
+   DATASYNC.  Returns 0 on success, -1 if FD is not an open file.
+   FILE_LOCK keeps the file's clusters from changing while they are
+   gathered; file_sync() drops it while waiting for the disk, so that
+   concurrent callers can share one commit. */
+int fsync (int fd, bool datasync) {
+	struct fd_structure *fd_elem = find_by_fd_index(fd);
+	if (fd_elem == NULL || fd_elem->current_file == NULL)
+		return -1;
+
+	lock_acquire(&file_lock);
+	file_sync(fd_elem->current_file, datasync, &file_lock);
+	lock_release(&file_lock);
+	return 0;
+}
+
+/* Writes every file system change made so far to disk. */
+void sync (void) {
+	filesys_sync();
+}
+
+/* Mounts the file system on disk CHAN_NO:DEV_NO on the directory
+   PATH.  Returns 0 on success, -1 on failure. */
+int mount (const char *path, int chan_no, int dev_no) {
+	check_address(path);
+
+	lock_acquire(&file_lock);
+	int result = filesys_mount(path, chan_no, dev_no);
+	lock_release(&file_lock);
+	return result;
+}
+
+/* Unmounts the file system mounted on PATH.  Returns 0 on success,
+   -1 on failure. */
+int umount (const char *path) {
+	check_address(path);
+
+	lock_acquire(&file_lock);
+	int result = filesys_umount(path);
+	lock_release(&file_lock);
+	return result;
+}
+
 int symlink (const char *target, const char *linkpath) {
 	/* soft link임.
 	다른 file 또는 directory를 참조하는 pseudo file 개체임.
@@ -1179,14 +1352,18 @@ int symlink (const char *target, const char *linkpath) {
 	strlcpy(file_name, linkpath_token, strlen(linkpath_token) + 1);
 
 	// printf("(symlink) file_name: %s\n", file_name);
-	// 새로운 chain을 만들어서 inode sector 번호를 받아야 함
-	cluster_t inode_sector_num = fat_create_chain(0);
-
 	// dir이 NULL이면 당연히 error
+	cluster_t inode_sector_num = 0;
+	struct fs *fs = NULL;
 	if (real_dir == NULL) { goto error; }
+
+	// 새로운 chain을 만들어서 inode sector 번호를 받아야 함
+	fs = inode_get_fs(dir_get_inode(real_dir));
+	inode_sector_num = fat_create_chain(fs, 0);
+	if (inode_sector_num == 0) { goto error; }
 	
 	// inode를 만들어야 함
-	bool make_inode = inode_create(cluster_to_sector(inode_sector_num), 0, false);
+	bool make_inode = inode_create(fs, cluster_to_sector(fs, inode_sector_num), 0, false);
 	if (!make_inode) { goto error; }
 
 	/*
@@ -1194,14 +1371,15 @@ int symlink (const char *target, const char *linkpath) {
 	if (!create_dir) { goto error; }
 	*/
 
-	// dir에 file_name entry를 추가해줘야 함. 잘 안되면 당연히 goto error
-	bool add_file_name = dir_add(real_dir, file_name, cluster_to_sector(inode_sector_num));
-	if (!add_file_name) { goto error; }
-
 	// 이렇게 만들어진 sector에 위에서 받은 file_name의 dir을 만들어야 함. 안 만들어지면 당연히 error
-	bool link_inode = create_link_inode(cluster_to_sector(inode_sector_num), copy_target);
+	/* Before dir_add(), which records the entry's type. */
+	bool link_inode = create_link_inode(fs, cluster_to_sector(fs, inode_sector_num), copy_target);
 	if (!link_inode) { goto error; }
 
+	// dir에 file_name entry를 추가해줘야 함. 잘 안되면 당연히 goto error
+	bool add_file_name = dir_add(real_dir, file_name, cluster_to_sector(fs, inode_sector_num));
+	if (!add_file_name) { goto error; }
+
 	dir_close(real_dir);
 	free(copy_target);
 	free(copy_linkpath);
@@ -1212,7 +1390,7 @@ int symlink (const char *target, const char *linkpath) {
 	return 0; // 성공하면 0 반환
 error:
 	if (inode_sector_num != 0) {
-		fat_remove_chain(inode_sector_num, 0);
+		fat_remove_chain(fs, inode_sector_num, 0);
 	}
 	dir_close(real_dir);
 	free(copy_target);
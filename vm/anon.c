@@ -5,7 +5,10 @@
 #include "threads/mmu.h"
 #include "threads/vaddr.h"
 #include "threads/malloc.h"
+#include <string.h>
 #include "bitmap.h"
+#include "filesys/inode.h"
+#include "vm/zswap.h"
 
 /* DO NOT MODIFY BELOW LINE */
 static struct disk *swap_disk;
@@ -16,6 +19,30 @@ static void anon_destroy (struct page *page);
 /* swap을 위한 table이 필요함 - bitmap을 이용해야 */
 struct bitmap *swap_list;
 
+/* Sectors in one swap slot, which holds one page. */
+#define SLOT_SECTORS (PGSIZE / DISK_SECTOR_SIZE)
+
+/* Swap slots are handed out next-fit from SWAP_CURSOR.  The first page
+ * of a batch reserves a cluster of up to SWAP_BATCH contiguous slots and
+ * the following ones fill it in order, so their writes are adjacent and
+ * the disk scheduler merges them into one transfer.  All of this is
+ * protected by frame_lock. */
+static size_t swap_cursor;
+static size_t cluster_next;             /* Next slot of the cluster. */
+static size_t cluster_left;             /* Slots left in the cluster. */
+
+/* Writes of the current batch, waited for by anon_swap_flush(). */
+static struct disk_request swap_reqs[SWAP_BATCH];
+static size_t swap_pending;
+
+/* Page held by each swap slot, or a null pointer.  Lets a swap-in find
+ * the pages in the slots around it. */
+static struct page **slot_pages;
+
+/* Reads issued by one swap-in, the faulting page's first. */
+static struct disk_request read_reqs[SWAP_BATCH];
+static struct page *read_pages[SWAP_BATCH];
+
 /* DO NOT MODIFY this struct */
 static const struct page_operations anon_ops = {
 	.swap_in = anon_swap_in,
@@ -31,8 +58,12 @@ vm_anon_init (void) {
 	//swap_disk = NULL;
 
 	/* bitmap을 사용하여 init해주면 됨 */
-	swap_disk = disk_get(1, 1);
+	swap_disk = disk_get_role (DISK_SWAP);
 	swap_list = bitmap_create(disk_size(swap_disk) / 8); // 하드드라이브 최소 기억 단위가 8바이트임!
+	slot_pages = calloc(bitmap_size(swap_list), sizeof *slot_pages);
+	if (swap_list == NULL || slot_pages == NULL)
+		PANIC("vm_anon_init: cannot allocate the swap table");
+	zswap_init();
 }
 
 /* Initialize the file mapping */
@@ -42,7 +73,90 @@ anon_initializer (struct page *page, enum vm_type type, void *kva) {
 	page->operations = &anon_ops;
 
 	struct anon_page *anon_page = &page->anon;
+	anon_page->zswap = NULL;
 	anon_page->bitmap_index = -1; // index는 뭐든지 0부터 시작하므로, 0인 순간 이미 bitmap에 존재한다는 의미가 됨. 아직 bitmap에 들어가지 않은 상태의 init은 -1로 해줘야
+	anon_page->text_inode = NULL;
+	return true;
+}
+
+/* Records that PAGE holds the read-only text made of READ_BYTES bytes
+ * at OFS in INODE followed by zeros.  Such a page never changes, so
+ * eviction drops it instead of swapping it out, and the next fault
+ * reads it again.  Writes to INODE are denied until PAGE goes away, so
+ * that what is read then is what was dropped. */
+void
+anon_set_text (struct page *page, struct inode *inode, off_t ofs,
+		size_t read_bytes) {
+	struct anon_page *anon_page = &page->anon;
+
+	ASSERT (page->operations == &anon_ops);
+	ASSERT (anon_page->text_inode == NULL);
+
+	anon_page->text_inode = inode_reopen (inode);
+	anon_page->text_ofs = ofs;
+	anon_page->text_read_bytes = read_bytes;
+	inode_deny_write (inode);
+}
+
+/* If PAGE is text recorded by anon_set_text(), unmaps it from its frame
+ * without saving its contents and returns true.  Otherwise returns
+ * false. */
+bool
+anon_drop_text (struct page *page) {
+	if (page->operations != &anon_ops || page->anon.text_inode == NULL)
+		return false;
+
+	pml4_clear_page(page->owner->pml4, page->va);
+	page->frame = NULL;
+	return true;
+}
+
+/* Reads text PAGE from its executable into KVA. */
+static bool
+text_read (struct page *page, void *kva) {
+	struct anon_page *anon_page = &page->anon;
+	size_t read_bytes = anon_page->text_read_bytes;
+
+	if (inode_read_at(anon_page->text_inode, kva, read_bytes,
+				anon_page->text_ofs) != (off_t) read_bytes)
+		return false;
+	memset(kva + read_bytes, 0, PGSIZE - read_bytes);
+	return true;
+}
+
+/* Starts reading swapped-out PAGE into its frame, along with the other
+ * pages of the same process in the slots around it, for which it takes
+ * frames that are free anyway.  The reads are adjacent, so the disk
+ * scheduler merges them.  Returns the number of reads started, which
+ * are in READ_REQS and READ_PAGES. */
+static size_t
+swap_read_around (struct page *page) {
+	size_t slot = page->anon.bitmap_index;
+	size_t first = slot > SWAP_BATCH / 2 ? slot - SWAP_BATCH / 2 : 0;
+	size_t last = first + SWAP_BATCH;
+	size_t cnt = 0;
+
+	if (last > bitmap_size(swap_list))
+		last = bitmap_size(swap_list);
+
+	read_pages[cnt] = page;
+	disk_read_async(swap_disk, slot * SLOT_SECTORS, SLOT_SECTORS,
+			page->frame->kva, &read_reqs[cnt++], NULL, NULL);
+
+	for (size_t s = first; s < last && cnt < SWAP_BATCH; s++) {
+		struct page *p = slot_pages[s];
+		if (s == slot || p == NULL || p->owner != page->owner)
+			continue;
+
+		struct frame *frame = vm_get_spare_frame();
+		if (frame == NULL)
+			break;
+		vm_frame_link(frame, p);
+		read_pages[cnt] = p;
+		disk_read_async(swap_disk, s * SLOT_SECTORS, SLOT_SECTORS,
+				frame->kva, &read_reqs[cnt++], NULL, NULL);
+	}
+	return cnt;
 }
 
 /* Swap in the page by read contents from the swap disk. */
@@ -56,19 +170,36 @@ anon_swap_in (struct page *page, void *kva) {
 	//printf(" swap in index: %d\n", anon_page->bitmap_index);
 	// swap disk에 이 page의 index가 없으면 fail,
 	// disk에 있으면 읽은 다음에, swap in되었다는 뜻인 false으로 세팅
-	bool is_there = bitmap_test(swap_list, anon_page->bitmap_index);
+	if (anon_page->zswap != NULL) {
+		zswap_load(page, kva);
+		return true;
+	}
+	bool is_there = anon_page->bitmap_index >= 0
+		&& bitmap_test(swap_list, anon_page->bitmap_index);
 	if (is_there) {
-		// 그리고 이제 swap in 되었다는 0으로 세팅해주고
-		bitmap_set(swap_list, anon_page->bitmap_index, false);
 		// disk에 있는 data들을 kva로 읽어오면 됨
-		for (int i=0; i<8; i++) {
-			disk_read(swap_disk, (anon_page->bitmap_index)*8+i, page->frame->kva+DISK_SECTOR_SIZE*i);
+		size_t cnt = swap_read_around(page);
+		for (size_t i = 0; i < cnt; i++) {
+			struct page *p = read_pages[i];
+			disk_wait(&read_reqs[i]);
+			// 그리고 이제 swap in 되었다는 0으로 세팅해주고
+			bitmap_set(swap_list, p->anon.bitmap_index, false);
+			slot_pages[p->anon.bitmap_index] = NULL;
+			p->anon.bitmap_index = -1;
+			/* Map the prefetched pages right away; their accessed
+			 * bits stay clear, so the clock takes back the ones
+			 * that are never touched first. */
+			if (p != page)
+				pml4_set_page(p->owner->pml4, p->va, p->frame->kva, p->write);
 		}
 		//printf("page addr: 0x%x, kva: 0x%x\n", page, kva);
 		//printf("kernel에 있냐 %d\n", is_kernel_vaddr(page));
 		page->frame->kva = kva;
 		//printf("(swap in) page addr: 0x%x, frame addr: 0x%x, kva: 0x%x\n", page, page->frame, page->frame->kva);
 		return true;
+	} else if (anon_page->text_inode != NULL) {
+		/* Text dropped by eviction. */
+		return text_read(page, kva);
 	} else {
 		//printf("설마 is_there이 이상해?\n");
 		return false;
@@ -76,31 +207,120 @@ anon_swap_in (struct page *page, void *kva) {
 	
 }
 
+/* Reads swapped-out PAGE's contents into KVA, keeping its swap slot.
+ * Used when fork() copies a page that the parent has swapped out. */
+bool
+anon_swap_copy (struct page *page, void *kva) {
+	int index = page->anon.bitmap_index;
+	struct disk_request req;
+	bool success = true;
+
+	lock_acquire(&frame_lock);
+	if (page->anon.zswap != NULL) {
+		zswap_copy(page, kva);
+	} else if (index >= 0 && bitmap_test(swap_list, index)) {
+		disk_read_async(swap_disk, index * SLOT_SECTORS, SLOT_SECTORS, kva,
+				&req, NULL, NULL);
+		disk_wait(&req);
+	} else {
+		success = false;
+	}
+	lock_release(&frame_lock);
+	return success;
+}
+
+/* Allocates a swap slot, reserving a new cluster if the current one is
+ * used up.  Returns BITMAP_ERROR if swap is full. */
+static size_t
+swap_slot_alloc (void) {
+	if (cluster_left == 0) {
+		for (size_t cnt = SWAP_BATCH; cnt > 0 && cluster_left == 0; cnt /= 2) {
+			size_t idx = bitmap_scan_and_flip(swap_list, swap_cursor, cnt, false);
+			if (idx == BITMAP_ERROR && swap_cursor != 0)
+				idx = bitmap_scan_and_flip(swap_list, 0, cnt, false);
+			if (idx != BITMAP_ERROR) {
+				cluster_next = idx;
+				cluster_left = cnt;
+				swap_cursor = (idx + cnt) % bitmap_size(swap_list);
+			}
+		}
+		if (cluster_left == 0)
+			return BITMAP_ERROR;
+	}
+	cluster_left--;
+	return cluster_next++;
+}
+
+/* Waits for the pending swap writes, after which the frames they came
+ * from may be reused, and releases the unused rest of the cluster. */
+void
+anon_swap_flush (void) {
+	for (size_t i = 0; i < swap_pending; i++)
+		disk_wait(&swap_reqs[i]);
+	swap_pending = 0;
+
+	if (cluster_left > 0) {
+		bitmap_set_multiple(swap_list, cluster_next, cluster_left, false);
+		cluster_left = 0;
+	}
+}
+
+/* Writes BUF, the contents of swapped-out PAGE, to a new swap slot and
+ * waits for it.  Used by zswap to push out pages it cannot keep. */
+bool
+anon_swap_write (struct page *page, const void *buf) {
+	struct disk_request req;
+	size_t slot = swap_slot_alloc();
+
+	if (slot == BITMAP_ERROR)
+		return false;
+	disk_write_async(swap_disk, slot * SLOT_SECTORS, SLOT_SECTORS, buf,
+			&req, NULL, NULL);
+	disk_wait(&req);
+	page->anon.bitmap_index = slot;
+	slot_pages[slot] = page;
+	return true;
+}
+
 /* Swap out the page by writing contents to the swap disk. */
+/* The page goes to zswap if it can.  Otherwise the write is only
+ * started, and the caller must call anon_swap_flush() before reusing
+ * the frame. */
 static bool
 anon_swap_out (struct page *page) {
 	struct anon_page *anon_page = &page->anon;
+	uint64_t *pml4 = page->owner->pml4;
 
 	
 	//printf("swap out이 문제야?\n");
 
+	/* Unmap first: kswapd may evict a page of a running process, and a
+	 * write after this point must fault instead of being lost.  That
+	 * fault waits on frame_lock until the page is out. */
+	pml4_clear_page(pml4, page->va);
+	pml4_set_dirty(pml4, page->va, 0); // dirty가 false인 상태여야함
+	if (zswap_store(page, page->frame->kva)) {
+		page->frame = NULL;
+		return true;
+	}
+
 	// swap in과 반대다. page의 내용을 disk에 적어서 백업해두고, page는 삭제하는 용도
 	// 그럼 먼저 disk에 넣을 수 있는 공간을 찾아준다.
-	// false라는 건 swap in 되었어서 이미 page에 다시 적혀서 disk에서는 없어져도 되는 애들임
-	size_t empty_index = bitmap_scan(swap_list, 0, 1, false);
+	if (swap_pending == SWAP_BATCH)
+		anon_swap_flush();
+	size_t empty_index = swap_slot_alloc();
 	if (empty_index == BITMAP_ERROR) {
-		return false; // BITMAP_ERROR라는건 거기 안에 빈공간이 없다는 거다...
+		// BITMAP_ERROR라는건 거기 안에 빈공간이 없다는 거다...
+		/* Still copy-on-write if others share the frame. */
+		pml4_set_page(pml4, page->va, page->frame->kva,
+				page->write && page->frame->ref_cnt == 1);
+		return false;
 	} else {
-		// index가 잘 찾아졌으면 이제 swap out 되었다는 1로 세팅
-		bitmap_set(swap_list, empty_index, true);
 		anon_page->bitmap_index = empty_index;
+		slot_pages[empty_index] = page;
 		// swap in과 반대로 disk write를 해주면 됨
-		for (int i=0; i<8; i++) {
-			disk_write (swap_disk, empty_index*8+i, page->frame->kva+DISK_SECTOR_SIZE*i);
-		}
-		// page의 내용들을 disk로 다 옮겼으므로 이제 page를 reset해줘야함
-		pml4_clear_page(thread_current()->pml4, page->va);
-		pml4_set_dirty(thread_current()->pml4, page->va, 0); // dirty가 false인 상태여야함
+		disk_write_async(swap_disk, empty_index * SLOT_SECTORS, SLOT_SECTORS,
+				page->frame->kva, &swap_reqs[swap_pending++], NULL, NULL);
 		//printf("swap out index: %d\n", anon_page->bitmap_index);
 		page->frame = NULL;
 
@@ -125,9 +345,26 @@ anon_destroy (struct page *page) {
 	//페이지랑 물리 프레임의 할당도 free해줘야한다
 
 	*/
+	lock_acquire(&frame_lock);
 	if (page->frame != NULL) {
-		list_remove(&(page->frame->elem));
-		free(page->frame);
-		page->frame = NULL;
+		struct frame *frame = page->frame;
+		if (vm_frame_unlink(page) == 0) {
+			vm_frame_free(frame);
+		} else {
+			/* Still shared copy-on-write: unmap it so that
+			 * pml4_destroy() does not free it under the others. */
+			pml4_clear_page(thread_current()->pml4, page->va);
+		}
+	} else if (anon_page->zswap != NULL) {
+		zswap_drop(page);
+	} else if (anon_page->bitmap_index >= 0) {
+		/* Swapped out: give its slot back. */
+		bitmap_set(swap_list, anon_page->bitmap_index, false);
+		slot_pages[anon_page->bitmap_index] = NULL;
+	}
+	if (anon_page->text_inode != NULL) {
+		inode_allow_write(anon_page->text_inode);
+		inode_close(anon_page->text_inode);
 	}
+	lock_release(&frame_lock);
 }
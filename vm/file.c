@@ -74,15 +74,16 @@ file_backed_swap_out (struct page *page) {
 		//printf("file swap out은 잘 됨\n");
 		/* 이번에는 file이 적혀있는 page를 찾아서, page에 적혀있는 내용들을 file에 다시 적고
 		page를 clear 해주면 됨 */
-		if (pml4_is_dirty(thread_current()->pml4, page->va)) {
+		/* The victim may belong to another process: go through its
+		 * owner's pml4 and write from the frame, not the user va. */
+		uint64_t *pml4 = page->owner->pml4;
+		/* Unmap before writing back, as anon_swap_out() does; the
+		 * dirty bit survives pml4_clear_page(). */
+		pml4_clear_page(pml4, page->va); // dirty하지 않더라도 page는 clear 해줘야함. 더이상은 안 쓰는 page니까
+		if (pml4_is_dirty(pml4, page->va)) {
 			/* 해당 page가 dirty한 상태 (file 내용이 적혀있는 상태)면 file에 page 내용 적어준다 */
-			file_write_at(file_page->aux->page_file, page->va, file_page->aux->read_bytes, file_page->aux->offset);
-			/* anon에서 swap out 했을 때처럼 page reset 해주면 됨 */
-			pml4_clear_page(thread_current()->pml4, page->va); // file로 writeback한 이후 page 비워주고
-			pml4_set_dirty(thread_current()->pml4, page->va, 0); // 다 옮겨 적었다고 표시. dirty가 false인 상태
-		} else {
-			/* page에 아무것도 안 적혀있으면 당연히 file에 writeback 안 하지! */
-			pml4_clear_page(thread_current()->pml4, page->va); // dirty하지 않더라도 page는 clear 해줘야함. 더이상은 안 쓰는 page니까
+			pml4_set_dirty(pml4, page->va, 0); // 다 옮겨 적었다고 표시. dirty가 false인 상태
+			file_write_at(file_page->aux->page_file, page->frame->kva, file_page->aux->read_bytes, file_page->aux->offset);
 		}
 		page->frame = NULL; // frame은 NULL한 상태로 초기화 해줘야 함
 		return true;
@@ -111,10 +112,12 @@ file_backed_destroy (struct page *page) {
 	hash_delete(&thread_current()->spt.page_table, &page->hash_elem);
 
 	/* 그리고 page를 free해줘야 한다. */
+	lock_acquire(&frame_lock);
 	if (page->frame != NULL) {
-		free(page->frame);
+		vm_frame_free(page->frame);
 	}
 	page->frame = NULL;
+	lock_release(&frame_lock);
 
 }
 
@@ -0,0 +1,107 @@
+/* text.c: Cache of the resident read-only pages of executables. */
+
+#include "vm/text.h"
+#include <debug.h>
+#include <hash.h>
+#include "filesys/inode.h"
+#include "threads/malloc.h"
+#include "vm/vm.h"
+
+/* Read-only segment pages of an executable are the same in every
+ * process that runs it, so the first process to fault one in records
+ * its frame here under the file's inode, the page's offset in it and
+ * the number of bytes read from there, and the rest map that frame
+ * instead of reading the page again.  An entry lives as
+ * long as its frame: when the last page mapping the frame goes away or
+ * the frame is evicted, vm_frame_free() removes it.  While an entry
+ * exists it keeps the inode open and denies writes to it, so that the
+ * cached contents stay those of the file.
+ *
+ * Everything here runs under frame_lock. */
+
+/* A cached page. */
+struct text_entry {
+	struct hash_elem elem;          /* Element in ENTRIES. */
+	struct inode *inode;            /* Executable it was read from. */
+	off_t ofs;                      /* Page offset in INODE. */
+	size_t read_bytes;              /* Bytes from INODE; the rest is zeros. */
+	struct frame *frame;            /* Frame holding the page. */
+};
+
+static struct hash entries;
+
+static uint64_t
+text_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct text_entry *t = hash_entry (e, struct text_entry, elem);
+	return hash_bytes (&t->inode, sizeof t->inode)
+		^ hash_int (t->ofs) ^ hash_int (t->read_bytes);
+}
+
+static bool
+text_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct text_entry *a = hash_entry (a_, struct text_entry, elem);
+	const struct text_entry *b = hash_entry (b_, struct text_entry, elem);
+
+	if (a->inode != b->inode)
+		return a->inode < b->inode;
+	if (a->ofs != b->ofs)
+		return a->ofs < b->ofs;
+	return a->read_bytes < b->read_bytes;
+}
+
+/* Initializes the text cache. */
+void
+text_init (void) {
+	hash_init (&entries, text_hash, text_less, NULL);
+}
+
+/* Returns the frame caching the page made of READ_BYTES bytes at OFS
+ * in INODE followed by zeros, or NULL.  Two segments may share a file
+ * page but read different amounts of it, so READ_BYTES is part of the
+ * key. */
+struct frame *
+text_lookup (struct inode *inode, off_t ofs, size_t read_bytes) {
+	struct text_entry key;
+	struct hash_elem *e;
+
+	key.inode = inode;
+	key.ofs = ofs;
+	key.read_bytes = read_bytes;
+	e = hash_find (&entries, &key.elem);
+	return e != NULL ? hash_entry (e, struct text_entry, elem)->frame : NULL;
+}
+
+/* Records that FRAME holds the page made of READ_BYTES bytes at OFS in
+ * INODE followed by zeros.  Does nothing if memory runs out, which only
+ * costs sharing. */
+void
+text_insert (struct frame *frame, struct inode *inode, off_t ofs,
+		size_t read_bytes) {
+	struct text_entry *t;
+
+	ASSERT (frame->text == NULL);
+
+	t = malloc (sizeof *t);
+	if (t == NULL)
+		return;
+	t->inode = inode_reopen (inode);
+	t->ofs = ofs;
+	t->read_bytes = read_bytes;
+	t->frame = frame;
+	inode_deny_write (t->inode);
+	hash_insert (&entries, &t->elem);
+	frame->text = t;
+}
+
+/* Forgets the page cached in FRAME. */
+void
+text_remove (struct frame *frame) {
+	struct text_entry *t = frame->text;
+
+	hash_delete (&entries, &t->elem);
+	inode_allow_write (t->inode);
+	inode_close (t->inode);
+	free (t);
+	frame->text = NULL;
+}
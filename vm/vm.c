@@ -3,10 +3,43 @@
 #include "threads/malloc.h"
 #include "vm/vm.h"
 #include "vm/inspect.h"
+#include "vm/text.h"
+#include "filesys/file.h"
 #include <hash.h>
 #include "threads/mmu.h"
-
-struct list frame_list;
+#include "threads/synch.h"
+#include <stddef.h>
+#include <string.h>
+
+/* Frame table: one descriptor per page of the user pool, indexed by
+ * (kva - user pool base) / PGSIZE.  A descriptor is in use while some
+ * page maps it. */
+static struct frame *frame_table;
+static size_t frame_cnt;
+static uint8_t *frame_base;
+static size_t clock_hand;              /* Eviction hand into FRAME_TABLE. */
+struct lock frame_lock;
+
+/* A page of zeros that read faults on never-written anonymous pages
+ * map read-only.  It lives outside FRAME_TABLE, so it is never
+ * evicted, and holds one reference of its own, so it never looks
+ * unshared: the first write copies out of it in vm_handle_wp().  That
+ * includes writes by the kernel on behalf of a syscall, since start.S
+ * sets CR0.WP. */
+static struct frame zero_frame;
+
+/* Pages a fault on file contents may load at once; see
+ * vm_fault_around(). */
+#define FAULT_AROUND_PAGES 16
+
+/* kswapd wakes up when fewer than FREE_LOW user frames are free and
+ * evicts pages until FREE_HIGH are, so that page faults usually find a
+ * free frame without evicting one themselves. */
+static size_t free_low, free_high;
+static struct semaphore kswapd_wake;
+static bool kswapd_idle;               /* Waiting on KSWAPD_WAKE? */
+
+static void kswapd (void *aux);
 
 /* Initializes the virtual memory subsystem by invoking each subsystem's
  * intialize codes. */
@@ -20,7 +53,26 @@ vm_init (void) {
 	register_inspect_intr ();
 	/* DO NOT MODIFY UPPER LINES. */
 	/* TODO: Your code goes here. */
-	list_init(&frame_list); // 언제나 새로 선언하면 init 해줘야지~
+	frame_base = palloc_user_base ();
+	frame_cnt = palloc_user_page_cnt ();
+	frame_table = calloc (frame_cnt, sizeof *frame_table);
+	if (frame_table == NULL)
+		PANIC ("vm_init: cannot allocate the frame table");
+	for (size_t i = 0; i < frame_cnt; i++) {
+		frame_table[i].kva = frame_base + i * PGSIZE;
+		list_init (&frame_table[i].pages);
+	}
+	lock_init (&frame_lock);
+	text_init ();
+
+	zero_frame.kva = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+	list_init (&zero_frame.pages);
+	zero_frame.ref_cnt = 1;
+
+	free_low = frame_cnt / 64 + 4;
+	free_high = frame_cnt / 32 + 8;
+	sema_init (&kswapd_wake, 0);
+	thread_create ("kswapd", PRI_DEFAULT, kswapd, NULL);
 }
 
 /* Get the type of the page. This function is useful if you want to know the
@@ -40,8 +92,58 @@ page_get_type (struct page *page) {
 /* Helpers */
 static struct frame *vm_get_victim (void);
 static bool vm_do_claim_page (struct page *page);
+static bool vm_load_page (struct page *page, bool spare);
 static struct frame *vm_evict_frame (void);
 
+/* Returns the frame descriptor of user pool page KVA. */
+struct frame *
+vm_frame_of (void *kva) {
+	size_t idx = ((uint8_t *) pg_round_down (kva) - frame_base) / PGSIZE;
+
+	ASSERT (idx < frame_cnt);
+	return &frame_table[idx];
+}
+
+/* Maps FRAME into PAGE, one more user of the frame. */
+void
+vm_frame_link (struct frame *frame, struct page *page) {
+	list_push_back (&frame->pages, &page->frame_elem);
+	frame->ref_cnt++;
+	frame->page = page;
+	frame->owner = page->owner;
+	page->frame = frame;
+}
+
+/* Detaches PAGE from its frame and returns how many pages still map
+ * the frame.  FRAME->page is moved to one of them if it was PAGE. */
+int
+vm_frame_unlink (struct page *page) {
+	struct frame *frame = page->frame;
+
+	ASSERT (frame != NULL);
+	list_remove (&page->frame_elem);
+	frame->ref_cnt--;
+	if (frame->page == page)
+		frame->page = !list_empty (&frame->pages)
+			? list_entry (list_front (&frame->pages), struct page, frame_elem)
+			: NULL;
+	frame->owner = frame->page != NULL ? frame->page->owner : NULL;
+	page->frame = NULL;
+	return frame->ref_cnt;
+}
+
+/* Marks FRAME unused in the frame table.  The physical page is released
+ * later by pml4_destroy(). */
+void
+vm_frame_free (struct frame *frame) {
+	if (frame->text != NULL)
+		text_remove (frame);
+	list_init (&frame->pages);
+	frame->ref_cnt = 0;
+	frame->page = NULL;
+	frame->owner = NULL;
+}
+
 /* Create the pending page object with initializer. If you want to create a
  * page, do not create it directly and make it through this function or
  * `vm_alloc_page`. */
@@ -85,6 +187,7 @@ vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable,
 		//유저한테 다시 control을 준다
 		//writable을 인자로 받았으니 이 속성을 페이지에 업데이트 시켜줘야한다
 		new_page->write = writable;
+		new_page->owner = thread_current ();
 		/* TODO: Insert the page into the spt. */
 		/*
 		spt_insert_page(spt, new_page);
@@ -100,27 +203,16 @@ err:
 
 /* Find VA from spt and return page. On error, return NULL. */
 struct page *
-spt_find_page (struct supplemental_page_table *spt UNUSED, void *va UNUSED) {
-	struct page *page = (struct page *)malloc(sizeof(struct page));
-	/* TODO: Fill this function. */
+spt_find_page (struct supplemental_page_table *spt, void *va) {
 	//spt에서 해당 va를 가지고 있는 페이지를 빼오는거기 때문에 hash search 함수들을 이용하면 될거같다
+	/* Only VA is hashed and compared, so a key on the stack will do. */
 	struct page p;
 	p.va = pg_round_down(va);
-	//page->va = pg_round_down(va);
-
-	struct hash_elem *elem;
-	/*
-	elem = hash_find(&(spt->page_table), &(p.hash_elem));
-	*/
-	elem = hash_find(&thread_current()->spt.page_table, &p.hash_elem);
-	if (elem == NULL) {
-		free(page);
-		return NULL; 
-	}
 
-	page = hash_entry(elem, struct page, hash_elem);
-	return page;
-	//return hash_entry(elem, struct page, hash_elem);
+	struct hash_elem *elem = hash_find(&spt->page_table, &p.hash_elem);
+	if (elem == NULL)
+		return NULL;
+	return hash_entry(elem, struct page, hash_elem);
 }
 
 /* Insert PAGE into spt with validation. */
@@ -147,53 +239,41 @@ spt_remove_page (struct supplemental_page_table *spt, struct page *page) {
 	return;
 }
 
-/* Get the struct frame, that will be evicted. */
-static struct frame *
-vm_get_victim (void) {
-	struct frame *victim = NULL;
-	//printf("여기 들어가냐?\n");
-	 /* TODO: The policy for eviction is up to you. */
-	 // 여기서 policy는 up to u라고 하긴 하는데, 일단 알려준대로 해야겠지?
-	 // 그러면, 1이라고 access bit이 표시 된 애는 최근에 참조된 애고
-	 // 0인 애들은 최근에 참조가 안 된 애들이다. 그러면 이제 얘네들이 지워져도 되는것임!
-	 // 그럼 일단, frame list를 쭉 돌아본다. 여기서 1인 애들은 0으로 바꿔주고,
-	 // 0인 애들은 victim인 것이다.
-	 /*
-	 if (list_empty(list_begin(&frame_list))) {
-		return;
-	 }
-	 */
-
-	 if (list_empty(&frame_list)) {
-		return;
-	 }
-
-	 //return list_entry(list_begin(&frame_list), struct frame, elem);
+/* Returns true if any page mapping FRAME was accessed since the last
+ * call, reading and clearing the accessed bit in each sharer's pml4. */
+static bool
+vm_frame_accessed (struct frame *frame) {
+	bool accessed = false;
 
-	 
-	 struct list_elem *frame;
+	for (struct list_elem *e = list_begin (&frame->pages);
+			e != list_end (&frame->pages); e = list_next (e)) {
+		struct page *page = list_entry (e, struct page, frame_elem);
+		uint64_t *pml4 = page->owner->pml4;
 
-	 for (frame = list_begin(&frame_list); frame != list_end(&frame_list); frame = list_next(frame)) {
-		victim = list_entry(frame, struct frame, elem);
-		if (pml4_is_accessed(thread_current()->pml4, victim->page->va)) {
-			// recently하게 방문되었으면 true를 반환해줌. 따라서, 이렇게 최근에 반환된 애들은 이제 0으로 세팅해주면 됨
-			pml4_set_accessed(thread_current()->pml4, victim->page->va, false);
-		} else {
-			break; // 이러면 이제 공개적으로 0인 애들이니까 얘를 반환하면 됨
+		if (pml4_is_accessed (pml4, page->va)) {
+			pml4_set_accessed (pml4, page->va, false);
+			accessed = true;
 		}
-	 }
-	 
-	 //printf("여기가 문제야?\n");
-	 //if (victim == list_entry(list_end(&frame_list), struct frame, elem)) {
-	 if (frame == list_end(&frame_list)) {
-		// 만약에 이 for문이 끝까지 갔다면, 이 frame list 안에서 victim이 없다는 말임. 다 최근에 access되었다는 뜻이겠지..
-		// 그러면 이제 여기서도 앞 for문에서 0으로 바꿔주었기 때문에, 무조건 첫 번쨰 애가 0이겠지
-		// 그러면 그냥 첫 번째 애를 반환하면 될듯!!
-		//victim = list_entry(list_begin(&frame_list), struct frame, elem);
-		return vm_get_victim(); // 끝까지 갔으면 한 번 더 돌린다
-	 }
-	return victim;
-	
+	}
+	return accessed;
+}
+
+/* Get the struct frame, that will be evicted. */
+/* Second-chance clock over FRAME_TABLE.  The hand keeps its place between
+ * calls, and a frame counts as accessed if any page mapping it was.
+ * Two sweeps are enough: the first one clears every bit it passes. */
+static struct frame *
+vm_get_victim (void) {
+	for (size_t i = 0; i < 2 * frame_cnt; i++) {
+		struct frame *frame = &frame_table[clock_hand];
+		clock_hand = (clock_hand + 1) % frame_cnt;
+
+		if (frame->page == NULL || frame->pinned)
+			continue;
+		if (!vm_frame_accessed (frame))
+			return frame;
+	}
+	return NULL;
 }
 
 /* Evict one page and return the corresponding frame.
@@ -201,18 +281,30 @@ vm_get_victim (void) {
 static struct frame *
 vm_evict_frame (void) {
 	struct frame *victim UNUSED = vm_get_victim ();
+	if (victim == NULL)
+		return NULL;
 	/* TODO: swap out the victim and return the evicted frame. */
 	// victim frame을 swap out하고, 이렇게 완전 비워진 frame을 return하는 함수임!
 	// 즉, 이미 최근에 access되었으면 통과, 아니면 victim으로 select 되어야 한다.
-	bool swap_out_well = swap_out(victim->page); // vm_get_victim을 통해 victim을 get해야 한다
-	if (swap_out_well) {
-		//victim->page = NULL; // frame도 reset해주는 과정
-		return victim;
-	} else {
-		return NULL;
+	/* A frame shared copy-on-write is swapped out for every page that
+	 * maps it, each of which gets a copy of its own in swap.  Text is
+	 * never written, so its pages are just unmapped and read again from
+	 * the text cache or the executable when they are next touched. */
+	while (!list_empty (&victim->pages)) {
+		struct page *page = list_entry (list_front (&victim->pages),
+				struct page, frame_elem);
+
+		if (!anon_drop_text (page) && !swap_out (page))
+			return NULL;
+		list_remove (&page->frame_elem);
+		victim->ref_cnt--;
+		if (!list_empty (&victim->pages)) {
+			victim->page = list_entry (list_front (&victim->pages),
+					struct page, frame_elem);
+			victim->owner = victim->page->owner;
+		}
 	}
-	//return victim;
-	//return NULL;
+	return victim;
 }
 
 /* palloc() and get frame. If there is no available page, evict the page
@@ -221,66 +313,88 @@ vm_evict_frame (void) {
  * space.*/
 static struct frame *
 vm_get_frame (void) {
-	//printf("마지막에 여기가 에러 0?\n");
-	//struct frame *frame = NULL;
-	//struct frame *frame;
-	/* TODO: Fill this function. */
-	// gitbook을 보면 이걸 제일 먼저 채우라고 적혀있음
-	// 위 설명을 읽어보면, 
+	struct frame *frame;
 	/* 1. user pool로부터 새로운 physical page를 얻는다 (palloc_get_page 이용) */
-	struct frame *frame = (struct frame*)malloc(sizeof(struct frame)); // 먼저 크기 배정
-	//frame = (struct frame*)malloc(sizeof(struct frame)); // 먼저 크기 배정
-	//printf("frame malloc이 안돼?\n");
-	//printf("아니면 PAL_USER이 안돼?\n");
-	frame->kva = palloc_get_page(PAL_USER); // user pool로부터 새로운 page 얻음
-	//printf("아니면 PAL_USER이 안돼?\n");
-	// 여기서, 만약 이미 빈 페이지였다면 그냥 그대로 return하면 되는데,
-	// 이미 frame이 다 차 있어서 빈 페이지가 더이상 남아있지 않다면 victim을 쫓아내고 빈칸으로 만들어야 함
-	// ASSERT (frame != NULL);
-	// ASSERT (frame->page == NULL);
-	//printf("마지막에 여기가 에러 1? frame->kva: 0x%x\n", frame->kva);
+	void *kva = palloc_get_page(PAL_USER);
 
-	/*
-	void *user_page = palloc_get_page(PAL_USER);
-	struct frame *frame = NULL;
-	if (user_page == NULL) {
-		frame->kva = NULL;
-		frame = vm_evict_frame();
-		frame->page = NULL;
-	} else {
-		frame->kva = user_page;
-		frame = (struct frame*)malloc(sizeof(struct frame));
-		frame->page = NULL;
-		list_push_back(&frame_list, &frame->elem);
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+	if (kswapd_idle && palloc_user_free_cnt () < free_low) {
+		kswapd_idle = false;
+		sema_up (&kswapd_wake);
 	}
-	*/
 
-	
-	if (frame->kva != NULL) {
-		// 이미 빈 칸이 있어서 그게 배치된 경우
-		// 새로운 frame을 가져왔으니 page를 초기화해주고, frame list에 넣기
-		//printf("마지막에 여기가 에러 2? frame->kva: 0x%x\n", frame->kva);
-		frame->page = NULL;
-		list_push_back(&frame_list, &frame->elem);
+	if (kva != NULL) {
+		frame = vm_frame_of(kva);
 	} else {
 		// 빈칸이 없어서 배당이 안 된 경우
 		// victim을 evict하고, 새로운 frame으로 비운다
-		// 위에 보니 vm_evict_frame()이라는 함수를 사용해야 하는 것 같음
-		// 근데 gitbook에는 일단 panic("todo")를 사용하라고 적혀있는 것 같은데...
-		//printf("마지막에 여기가 에러 3? frame->kva: 0x%x\n", frame->kva);
-		//PANIC("todo");
-		free(frame);
 		frame = vm_evict_frame();
-		//printf("마지막에 여기가 에러 3? frame->kva: 0x%x\n", frame->kva);
-		frame->page = NULL; // null로 해주는건, 일단 page를 reset (init)해주는 과정임!
+		anon_swap_flush();
+		if (frame == NULL)
+			return NULL;
 	}
-	
+	vm_frame_free (frame);
+
 	ASSERT (frame != NULL);
 	ASSERT (frame->page == NULL); // 이렇게 위에서 page->NULL을 해줘야 이걸 통과하는 거였다. page를 init하는 과정 뒤에 놨어야 했는데 내가 븅신이지...
 
 	return frame;
 }
 
+/* Page reclaim thread.  Sleeps until vm_get_frame() finds free frames
+ * below the low watermark, then evicts pages in batches of up to
+ * SWAP_BATCH, whose swap writes go out together, releasing FRAME_LOCK
+ * between batches, until the high watermark is reached. */
+static void
+kswapd (void *aux UNUSED) {
+	lock_acquire (&frame_lock);
+	for (;;) {
+		struct frame *batch[SWAP_BATCH];
+		size_t free_cnt = palloc_user_free_cnt ();
+		size_t cnt = 0;
+
+		while (cnt < SWAP_BATCH && free_cnt + cnt < free_high) {
+			struct frame *frame = vm_evict_frame ();
+			if (frame == NULL)
+				break;
+			/* Unused from now on, so the clock hand skips it, but
+			 * not free until its contents are on disk. */
+			vm_frame_free (frame);
+			batch[cnt++] = frame;
+		}
+		anon_swap_flush ();
+		for (size_t i = 0; i < cnt; i++)
+			palloc_free_page (batch[i]->kva);
+
+		if (cnt == 0) {
+			/* Done, or nothing can be evicted right now. */
+			kswapd_idle = true;
+			lock_release (&frame_lock);
+			sema_down (&kswapd_wake);
+			lock_acquire (&frame_lock);
+			continue;
+		}
+		lock_release (&frame_lock);
+		lock_acquire (&frame_lock);
+	}
+}
+
+/* Returns a free frame without evicting anything, for prefetching, or
+ * a null pointer if free frames are down to the low watermark. */
+struct frame *
+vm_get_spare_frame (void) {
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+	if (palloc_user_free_cnt () <= free_low)
+		return NULL;
+
+	void *kva = palloc_get_page (PAL_USER);
+	if (kva == NULL)
+		return NULL;
+	struct frame *frame = vm_frame_of (kva);
+	vm_frame_free (frame);
+	return frame;
+}
+
 /* Growing the stack. */
 static void
 vm_stack_growth (void *addr) {
@@ -298,20 +412,156 @@ vm_stack_growth (void *addr) {
 	// 	}
 	// 	found_page = spt_find_page(&thread_current()->spt, adjusted_addr);
 	// }
-	bool alloc_success = vm_alloc_page(VM_ANON | VM_MARKER_STACK, adjusted_addr, true);
-	while (alloc_success) {
-		struct page *pg = spt_find_page(&thread_current()->spt, adjusted_addr);
-        vm_claim_page(adjusted_addr);
-        adjusted_addr += PGSIZE;
-		alloc_success = vm_alloc_page(VM_ANON | VM_MARKER_STACK, adjusted_addr, true);
-	}
+	/* The new pages are left unclaimed: the faulting access is retried
+	 * and faults them in one at a time, reads onto the zero frame. */
+	while (vm_alloc_page(VM_ANON | VM_MARKER_STACK | VM_MARKER_ZERO, adjusted_addr, true))
+		adjusted_addr += PGSIZE;
 
 	//vm_alloc_page(VM_ANON | VM_MARKER_STACK, adjusted_addr, true);
 }
 
+/* Returns true if PAGE has never been loaded and is known to start
+ * out all zeros. */
+static bool
+vm_is_zero_fill (struct page *page) {
+	return VM_TYPE (page->operations->type) == VM_UNINIT
+		&& (page->uninit.type & VM_MARKER_ZERO) != 0;
+}
+
+/* Returns true if PAGE is executable text that is not resident, either
+ * never loaded or dropped by eviction, and so may be in the text cache.
+ * Sets *INODE, *OFS and *READ_BYTES to where it is read from. */
+static bool
+vm_is_text (struct page *page, struct inode **inode, off_t *ofs,
+		size_t *read_bytes) {
+	if (VM_TYPE (page->operations->type) == VM_UNINIT
+			&& (page->uninit.type & VM_MARKER_TEXT) != 0) {
+		struct segment_info *info = page->uninit.aux;
+
+		*inode = file_get_inode (info->page_file);
+		*ofs = info->offset;
+		*read_bytes = info->read_bytes;
+		return true;
+	}
+	if (VM_TYPE (page->operations->type) == VM_ANON
+			&& page->anon.text_inode != NULL) {
+		*inode = page->anon.text_inode;
+		*ofs = page->anon.text_ofs;
+		*read_bytes = page->anon.text_read_bytes;
+		return true;
+	}
+	return false;
+}
+
+/* Maps PAGE read-only onto FRAME, whose contents it already has.  An
+ * uninit PAGE is turned into an anonymous page without running its
+ * initializer.  The caller must hold frame_lock. */
+static bool
+vm_map_shared_frame (struct page *page, struct frame *frame) {
+	struct uninit_page *uninit = &page->uninit;
+
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+
+	if (VM_TYPE (page->operations->type) == VM_UNINIT) {
+		ASSERT (VM_TYPE (uninit->type) == VM_ANON);
+		if (!uninit->page_initializer (page, uninit->type, frame->kva))
+			return false;
+	}
+	vm_frame_link (frame, page);
+	return pml4_set_page (thread_current ()->pml4, page->va, frame->kva, false);
+}
+
+/* Maps zero-fill PAGE onto the zero frame. */
+static bool
+vm_map_zero_page (struct page *page) {
+	bool success;
+
+	lock_acquire (&frame_lock);
+	success = vm_map_shared_frame (page, &zero_frame);
+	lock_release (&frame_lock);
+	return success;
+}
+
+/* Returns where in a file uninit PAGE is loaded from, or a null
+ * pointer if it is not loaded from a file. */
+static struct segment_info *
+vm_file_source (struct page *page) {
+	if (VM_TYPE (page->operations->type) != VM_UNINIT
+			|| (page->uninit.type & VM_MARKER_ZERO) != 0)
+		return NULL;
+	return page->uninit.aux;
+}
+
+/* After a fault at VA loaded the page at OFS in FILE, also loads the
+ * other pages of the aligned FAULT_AROUND_PAGES-page block around VA
+ * that map the same file contiguously and are not loaded yet, the ones
+ * after VA first.  Text cache hits cost no frame; the rest take only
+ * spare frames, and the first one that cannot be had stops the scan.
+ * Sequential accesses to a mapped file or executable then fault once
+ * per block instead of once per page. */
+static void
+vm_fault_around (void *va, struct file *file, off_t ofs) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	uintptr_t block = (uintptr_t) FAULT_AROUND_PAGES * PGSIZE;
+	uint8_t *start = (uint8_t *) ((uintptr_t) va & ~(block - 1));
+	size_t fault_idx = ((uint8_t *) va - start) / PGSIZE;
+
+	for (size_t k = 1; k < FAULT_AROUND_PAGES; k++) {
+		uint8_t *nva = start + (fault_idx + k) % FAULT_AROUND_PAGES * PGSIZE;
+		struct page *page = spt_find_page (spt, nva);
+		struct segment_info *info;
+
+		if (page == NULL || (info = vm_file_source (page)) == NULL
+				|| info->page_file != file
+				|| info->offset != ofs + (nva - (uint8_t *) va))
+			continue;
+		if (!vm_load_page (page, true))
+			break;
+	}
+}
+
 /* Handle the fault on write_protected page */
+/* PAGE is writable but mapped read-only because fork() left its frame
+ * shared.  Give PAGE a private copy, or just take the frame back if
+ * every other sharer is already gone. */
 static bool
-vm_handle_wp (struct page *page UNUSED) {
+vm_handle_wp (struct page *page) {
+	uint64_t *pml4 = thread_current ()->pml4;
+	bool success = false;
+
+	lock_acquire (&frame_lock);
+	struct frame *shared = page->frame;
+	if (shared != NULL && page->write) {
+		struct frame *frame = shared;
+		if (shared->ref_cnt > 1) {
+			/* Taking a frame may evict one, which must not be the
+			 * frame we are about to copy. */
+			shared->pinned = true;
+			frame = vm_get_frame ();
+			shared->pinned = false;
+			if (frame != NULL && page->frame != shared) {
+				/* PAGE lost SHARED after all: give the new frame
+				 * back and let the access fault again. */
+				palloc_free_page (frame->kva);
+				lock_release (&frame_lock);
+				return true;
+			}
+			if (frame != NULL) {
+				if (shared == &zero_frame)
+					memset (frame->kva, 0, PGSIZE);
+				else
+					memcpy (frame->kva, shared->kva, PGSIZE);
+				vm_frame_unlink (page);
+				vm_frame_link (frame, page);
+			}
+		}
+		if (frame != NULL) {
+			pml4_clear_page (pml4, page->va);
+			success = pml4_set_page (pml4, page->va, frame->kva, true);
+		}
+	}
+	lock_release (&frame_lock);
+	return success;
 }
 
 /* Return true on success */
@@ -328,6 +578,11 @@ vm_try_handle_fault (struct intr_frame *f, void *addr,
 	//rsp가 유저스택을 가르키고 있으면 이 스택 포인터를 그대로 써도 되는데 커널 스택을 가르키고 있다면 유저->커널로 바뀔때의 thread내의 rsp를 사용해야된다
 	bool success = true;
 	//유저는 자신의 가상공간만 접근할 수 있기 때문에 커널 가상 메모리에 접근하려고 하면 바로 프로세스 종료 시켜야한다
+	if (!(is_kernel_vaddr(addr) && user) && not_present == false) {
+		/* Present page: only a write to a copy-on-write page can be fixed. */
+		page = spt_find_page(spt, addr);
+		return write && page != NULL && vm_handle_wp(page);
+	}
 	//if (is_kernel_vaddr(addr) && user || addr == NULL || not_present == false) {
 	if (is_kernel_vaddr(addr) && user || not_present == false) {
 		//printf("kernel에 가려고 했어?\n");
@@ -383,7 +638,17 @@ vm_try_handle_fault (struct intr_frame *f, void *addr,
 				ASSERT(!is_kernel_vaddr(addr));
 				ASSERT(page != NULL);
 				ASSERT(!(write && page->write == false));
-				success = vm_do_claim_page(page);
+				if (!write && vm_is_zero_fill(page))
+					success = vm_map_zero_page(page);
+				else {
+					struct segment_info *src = vm_file_source(page);
+					struct file *file = src != NULL ? src->page_file : NULL;
+					off_t ofs = src != NULL ? src->offset : 0;
+
+					success = vm_do_claim_page(page);
+					if (success && file != NULL)
+						vm_fault_around(page->va, file, ofs);
+				}
 				//printf("분명히 return true를 했을텐데,...\n");
 			}
 		}
@@ -421,36 +686,60 @@ vm_claim_page (void *va UNUSED) {
 /* Claim the PAGE and set up the mmu. */
 static bool
 vm_do_claim_page (struct page *page) {
-	//printf("어디서 에러가 나는거야 1\n");
-	//printf("(vm_do_claim_page) page addr: 0x%x\n", page);
-	struct frame *frame = vm_get_frame ();
-	//printf("어디에러4\n");
-
-	if (frame == NULL) {
-		//printf("어디서 에러가 나는거야 2\n");
-		return false; // get frame 했는데 NULL이면 당연히 mapping 불가하므로 false 반환
-	}
+	return vm_load_page (page, false);
+}
 
-	/* Set links */
-	frame->page = page;
-	page->frame = frame;
-	//printf("어디에러 6\n");
-
-	/* TODO: Insert page table entry to map page's VA to frame's PA. */
-	// gitbook 설명대로라면, 위에서 vm_get_page로 frame을 갖고 온 다음에,
-	// MMU를 setting해준다. 즉, page table 안에서 va와 pa를 mapping하는걸 추가한다.
-	// 그리고, 잘 완료되었으면 true, 아니면 false를 반환한다
-	bool mapping_va_pa = install_page_in_vm(page->va, frame->kva, page->write);
-	//bool mapping_va_pa = pml4_set_page(&thread_current()->pml4, page->va, frame->kva, page->write);
-	if (mapping_va_pa) {
-		//printf("어디서 에러가 나는거야 3\n"); // 여기서 swap 하면서 에러가 일어난다.
-		return swap_in (page, frame->kva);
-	} else {
-		//printf("어디서 에러가 나는거야 4/n");
-		return false;
+/* Loads PAGE into a frame and maps it.  If SPARE, takes only a frame
+ * that is free anyway and fails rather than evict one. */
+static bool
+vm_load_page (struct page *page, bool spare) {
+	bool success = false;
+	bool is_text, uninit;
+	struct inode *text_inode = NULL;
+	off_t text_ofs = 0;
+	size_t text_read_bytes = 0;
+
+	lock_acquire (&frame_lock);
+	is_text = vm_is_text (page, &text_inode, &text_ofs, &text_read_bytes);
+	uninit = VM_TYPE (page->operations->type) == VM_UNINIT;
+	if (is_text) {
+		/* Another process running the same file may have it already. */
+		struct frame *cached = text_lookup (text_inode, text_ofs,
+				text_read_bytes);
+
+		if (cached != NULL) {
+			success = vm_map_shared_frame (page, cached);
+			if (success && uninit)
+				anon_set_text (page, text_inode, text_ofs, text_read_bytes);
+			lock_release (&frame_lock);
+			return success;
+		}
 	}
 
-	//return swap_in (page, frame->kva);
+	struct frame *frame = spare ? vm_get_spare_frame () : vm_get_frame ();
+	// get frame 했는데 NULL이면 당연히 mapping 불가하므로 false 반환
+	if (frame != NULL) {
+		/* Stack pages have no initializer to clear the frame. */
+		if (vm_is_zero_fill (page))
+			memset (frame->kva, 0, PGSIZE);
+
+		/* Set links */
+		vm_frame_link (frame, page);
+
+		/* TODO: Insert page table entry to map page's VA to frame's PA. */
+		// gitbook 설명대로라면, 위에서 vm_get_page로 frame을 갖고 온 다음에,
+		// MMU를 setting해준다. 즉, page table 안에서 va와 pa를 mapping하는걸 추가한다.
+		// 그리고, 잘 완료되었으면 true, 아니면 false를 반환한다
+		if (install_page_in_vm(page->va, frame->kva, page->write))
+			success = swap_in (page, frame->kva);
+		if (success && is_text) {
+			if (uninit)
+				anon_set_text (page, text_inode, text_ofs, text_read_bytes);
+			text_insert (frame, text_inode, text_ofs, text_read_bytes);
+		}
+	}
+	lock_release (&frame_lock);
+	return success;
 }
 
 static bool
@@ -473,7 +762,16 @@ supplemental_page_table_init (struct supplemental_page_table *spt UNUSED) {
 	hash_init(&spt->page_table, spt_hash, spt_compare, NULL);
 }
 
+/* Returns the thread whose supplemental page table is SPT. */
+static struct thread *
+spt_owner (struct supplemental_page_table *spt) {
+	return (struct thread *) ((uint8_t *) spt - offsetof (struct thread, spt));
+}
+
 /* Copy supplemental page table from src to dst */
+/* Resident anonymous pages are not copied: the child maps the parent's
+ * frame and both mappings become read-only, so the first write on
+ * either side faults into vm_handle_wp() and copies only that page. */
 bool
 supplemental_page_table_copy (struct supplemental_page_table *dst UNUSED,
 		struct supplemental_page_table *src UNUSED) {
@@ -496,11 +794,6 @@ supplemental_page_table_copy (struct supplemental_page_table *dst UNUSED,
 			if (!alloc_success) {
 				return false;
 			}
-			//allocate한 후에 바로 claim을 해서 이 페이지랑 프레임으로 매핑시켜줘야한다
-			bool claim_success = vm_claim_page(src_page->va);
-			if (!claim_success) {
-				return false;
-			}
 			//즉, 이 페이지가 잘 들어갔는지 확인하기 위해서 spt_find_page를 사용해서 NULL인지 아닌지를 확인할 수 있다
 			struct page *dst_page = spt_find_page(dst, src_page->va);
 			if (dst_page == NULL) {
@@ -508,19 +801,45 @@ supplemental_page_table_copy (struct supplemental_page_table *dst UNUSED,
 				// break;
 				return false;
 			} 
-			//매핑된 프레임에다가 내용을 넣어야한다
-			//src page의 프레임 주소에 맞는 커널 구역에 들어가서 여기에서의 하나의 프레임의 내용을 그래도 복사해서 dst의 해당 page에 맞는 프레임의 커널 구역에 내용 넣기
-			memcpy(dst_page->frame->kva, src_page->frame->kva, PGSIZE);
+			//src page의 프레임을 자식과 공유하고 양쪽 다 읽기 전용으로 매핑한다
+			lock_acquire(&frame_lock);
+			struct frame *frame = src_page->frame;
+			struct inode *text_inode = src_page->anon.text_inode;
+			if (frame != NULL) {
+				vm_frame_link(frame, dst_page);
+				success = swap_in(dst_page, frame->kva)
+					&& pml4_set_page(thread_current()->pml4, dst_page->va, frame->kva, false);
+				pml4_set_page(spt_owner(src)->pml4, src_page->va, frame->kva, false);
+			} else if (text_inode != NULL) {
+				/* Text dropped by eviction: the child reads it
+				 * back the same way when it touches it. */
+				success = dst_page->uninit.page_initializer(dst_page,
+						VM_ANON, NULL);
+			}
+			if (success && text_inode != NULL)
+				anon_set_text(dst_page, text_inode, src_page->anon.text_ofs,
+						src_page->anon.text_read_bytes);
+			lock_release(&frame_lock);
+			if (frame == NULL && text_inode == NULL) {
+				/* Swapped out in the parent: give the child its own copy. */
+				success = vm_claim_page(src_page->va)
+					&& anon_swap_copy(src_page, dst_page->frame->kva);
+			}
+			if (!success)
+				return false;
 		} else if (src_page_type == VM_UNINIT) {
-			if (src_page->uninit.type == VM_ANON) {
+			if (VM_TYPE(src_page->uninit.type) == VM_ANON) {
 				vm_initializer *src_init = src_page->uninit.init;
 				/*
 				void *src_aux = src_page->uninit.aux;
 				*/
-				void *src_aux = (struct segment_info *)malloc(sizeof(struct segment_info));
-				memcpy(src_aux, src_page->uninit.aux, sizeof(struct segment_info));
+				void *src_aux = NULL;
+				if (src_page->uninit.aux != NULL) {
+					src_aux = (struct segment_info *)malloc(sizeof(struct segment_info));
+					memcpy(src_aux, src_page->uninit.aux, sizeof(struct segment_info));
+				}
 
-				bool alloc_success = vm_alloc_page_with_initializer(VM_ANON, src_page->va, src_page->write, src_init, src_aux);
+				bool alloc_success = vm_alloc_page_with_initializer(src_page->uninit.type, src_page->va, src_page->write, src_init, src_aux);
 
 				if (!alloc_success) {
 					return false;
@@ -0,0 +1,199 @@
+/* zswap.c: Compressed in-memory cache in front of the swap disk. */
+
+#include "vm/zswap.h"
+#include <debug.h>
+#include <list.h>
+#include <lz.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "vm/vm.h"
+
+/* When enabled with -zswap, anonymous pages being swapped out are
+ * compressed into a pool of kernel memory instead of being written to
+ * the swap disk, and swapping them back in only decompresses them.
+ *
+ * The pool is made of whole pages, each holding up to two compressed
+ * pages, as Linux's zbud does: one right after the pool page's header
+ * and one flush with its end.  Pages that do not shrink to half of the
+ * room in a pool page, ZSWAP_MAX_LEN bytes, still go to the disk, so
+ * that any pool page with a free half can take any entry.  The pool
+ * size counts whole pool pages, which is what it really takes from the
+ * kernel pool.  When it is full, its oldest pages are written back to
+ * the disk to make room.
+ *
+ * Everything here runs under frame_lock. */
+
+/* A compressed page, in one half of a pool page. */
+struct zswap_entry {
+	struct list_elem elem;          /* Element in ENTRIES. */
+	struct page *page;              /* Page it holds, or NULL if free. */
+	struct zbud_page *zbud;         /* Pool page it is in. */
+	size_t len;                     /* Bytes of compressed contents. */
+};
+
+/* A page of the pool. */
+struct zbud_page {
+	struct list_elem elem;          /* Element in UNBUDDIED. */
+	struct zswap_entry first;       /* Data right after this header. */
+	struct zswap_entry last;        /* Data at the end of the page. */
+};
+
+/* Largest compressed page kept in the pool. */
+#define ZSWAP_MAX_LEN ((PGSIZE - sizeof (struct zbud_page)) / 2)
+
+static size_t pool_limit;           /* Pool size in bytes, 0 if disabled. */
+static size_t pool_used;            /* Bytes of pool pages. */
+static struct list entries;         /* All entries, oldest first. */
+static struct list unbuddied;       /* Pool pages with one half free. */
+
+static void *work;                  /* Compressor scratch memory. */
+static uint8_t *cbuf;               /* Compressed output. */
+static uint8_t *bounce;             /* Page decompressed for writeback. */
+
+/* Sets the pool size to KB kB.  0, the default, disables zswap. */
+void
+zswap_set_size (size_t kb) {
+	pool_limit = kb * 1024;
+}
+
+/* Initializes zswap, if enabled. */
+void
+zswap_init (void) {
+	list_init (&entries);
+	list_init (&unbuddied);
+	if (pool_limit == 0)
+		return;
+
+	work = malloc (LZ_WORK_SIZE);
+	cbuf = malloc (ZSWAP_MAX_LEN);
+	bounce = palloc_get_page (0);
+	if (work == NULL || cbuf == NULL || bounce == NULL)
+		PANIC ("zswap_init: out of memory");
+}
+
+/* Returns the compressed contents of E. */
+static uint8_t *
+entry_data (struct zswap_entry *e) {
+	uint8_t *zp = (uint8_t *) e->zbud;
+
+	if (e == &e->zbud->first)
+		return zp + sizeof *e->zbud;
+	return zp + PGSIZE - e->len;
+}
+
+/* Returns the other half of E's pool page. */
+static struct zswap_entry *
+buddy (struct zswap_entry *e) {
+	return e == &e->zbud->first ? &e->zbud->last : &e->zbud->first;
+}
+
+/* Removes E from the pool, and frees its pool page if that empties it. */
+static void
+remove_entry (struct zswap_entry *e) {
+	struct zbud_page *zp = e->zbud;
+
+	list_remove (&e->elem);
+	e->page->anon.zswap = NULL;
+	e->page = NULL;
+	if (buddy (e)->page == NULL) {
+		list_remove (&zp->elem);
+		palloc_free_page (zp);
+		pool_used -= PGSIZE;
+	} else
+		list_push_back (&unbuddied, &zp->elem);
+}
+
+/* Decompresses E into the page at KVA. */
+static void
+decompress (struct zswap_entry *e, void *kva) {
+	if (lz_decompress (entry_data (e), e->len, kva, PGSIZE) != PGSIZE)
+		PANIC ("zswap: corrupt page at %p", e->page->va);
+}
+
+/* Writes the oldest page in the pool to the swap disk.  Returns false
+ * if the disk is full. */
+static bool
+writeback_oldest (void) {
+	struct zswap_entry *e = list_entry (list_front (&entries),
+			struct zswap_entry, elem);
+
+	decompress (e, bounce);
+	if (!anon_swap_write (e->page, bounce))
+		return false;
+	remove_entry (e);
+	return true;
+}
+
+/* Returns a free half of a pool page, making room for a new pool page
+ * if there is none, or a null pointer on failure. */
+static struct zswap_entry *
+free_half (void) {
+	struct zbud_page *zp;
+
+	while (list_empty (&unbuddied) && pool_used + PGSIZE > pool_limit)
+		if (list_empty (&entries) || !writeback_oldest ())
+			return NULL;
+
+	if (!list_empty (&unbuddied)) {
+		zp = list_entry (list_pop_front (&unbuddied), struct zbud_page, elem);
+		return zp->first.page == NULL ? &zp->first : &zp->last;
+	}
+
+	zp = palloc_get_page (0);
+	if (zp == NULL)
+		return NULL;
+	zp->first.page = zp->last.page = NULL;
+	zp->first.zbud = zp->last.zbud = zp;
+	pool_used += PGSIZE;
+	return &zp->first;
+}
+
+/* Compresses PAGE, whose contents are at KVA, into the pool.  Returns
+ * false if zswap is disabled, the page does not compress well, or there
+ * is no room; the caller then writes it to the disk. */
+bool
+zswap_store (struct page *page, const void *kva) {
+	struct zswap_entry *e;
+	size_t len;
+
+	ASSERT (page->anon.zswap == NULL);
+	if (pool_limit == 0)
+		return false;
+
+	len = lz_compress (kva, PGSIZE, cbuf, ZSWAP_MAX_LEN, work);
+	if (len == 0)
+		return false;
+	e = free_half ();
+	if (e == NULL)
+		return false;
+
+	e->page = page;
+	e->len = len;
+	memcpy (entry_data (e), cbuf, len);
+	list_push_back (&entries, &e->elem);
+	if (buddy (e)->page == NULL)
+		list_push_back (&unbuddied, &e->zbud->elem);
+	page->anon.zswap = e;
+	return true;
+}
+
+/* Decompresses PAGE into KVA and removes it from the pool. */
+void
+zswap_load (struct page *page, void *kva) {
+	decompress (page->anon.zswap, kva);
+	remove_entry (page->anon.zswap);
+}
+
+/* Decompresses PAGE into KVA, leaving it in the pool. */
+void
+zswap_copy (struct page *page, void *kva) {
+	decompress (page->anon.zswap, kva);
+}
+
+/* Removes PAGE from the pool without reading it. */
+void
+zswap_drop (struct page *page) {
+	remove_entry (page->anon.zswap);
+}